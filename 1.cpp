@@ -2,55 +2,489 @@
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <algorithm>
 #include <string> 
+#include <cmath>
+#include <chrono>
+#include <climits>
+#include <memory>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <unordered_set>
+#include <map>
+#include <cstring>
+#include <charconv>
+#include <stdexcept>
+#include <cstdlib>
+#include <new>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define HEX_MMAP
+#endif
 using namespace std;
 
+// instrumentation of the AI's hot paths, compiled in with -DHEX_STATS and out otherwise.
+// the counters and the phase timers are summed per thread, every thread has its own
+// cache line of counters, so counting costs an uncontended add; playAIMove writes
+// what changed during each move as one JSON line to the standard error
+#ifdef HEX_STATS
+class Stats
+{
+    public:
+    enum Counter { PLAYOUTS, KERNEL_BATCHES, NODES, BOARD_COPIES, WINNER_CHECKS, ALLOCATIONS, BYTES,
+                   PREPARE_NS, EXPAND_NS, PLAYOUT_NS, COUNTERS };
+
+    // the names of the counters in the JSON records
+    static const char* name(int c)
+    {
+        static const char* NAMES[COUNTERS] = {"playouts", "kernel_batches", "nodes", "board_copies",
+            "winner_checks", "allocations", "bytes", "prepare_ns", "expand_ns", "playout_ns"};
+        return NAMES[c];
+    }
+
+    private:
+    static const int SLOTS = 64; // threads beyond this share slots, which only costs contention
+
+    struct alignas(64) Slot
+    {
+        atomic<long long> value[COUNTERS];
+    };
+
+    // the slots are static arrays and the slot of a thread is an integer, so counting
+    // never allocates and can be used by operator new
+    static Slot* slots()
+    {
+        static Slot s[SLOTS];
+        return s;
+    }
+    static Slot& local()
+    {
+        static atomic<int> next(0);
+        thread_local int slot = next.fetch_add(1, memory_order_relaxed) % SLOTS;
+        return slots()[slot];
+    }
+
+    public:
+    static inline void add(Counter c, long long n) { local().value[c].fetch_add(n, memory_order_relaxed); }
+
+    // the sums of all the threads
+    static void total(long long sums[COUNTERS])
+    {
+        for (int c = 0; c < COUNTERS; c++)
+        {
+            sums[c] = 0;
+            for (int s = 0; s < SLOTS; s++)
+                sums[c] += slots()[s].value[c].load(memory_order_relaxed);
+        }
+    }
+
+    // adds the nanoseconds of its scope to a counter
+    class Timer
+    {
+        Counter counter;
+        chrono::steady_clock::time_point start;
+
+        public:
+        Timer(Counter counter) : counter(counter), start(chrono::steady_clock::now()) {}
+        ~Timer() { add(counter, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()); }
+    };
+};
+#define HEX_COUNT(counter, n) Stats::add(Stats::counter, (n))
+#define HEX_TIMER(counter) Stats::Timer hexTimer(Stats::counter)
+
+// count the allocations and their bytes on every thread
+void* operator new(size_t n)
+{
+    HEX_COUNT(ALLOCATIONS, 1);
+    HEX_COUNT(BYTES, (long long)n);
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+// not inlined, so the compiler doesn't pair the free with the new of the caller
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+#else
+#define HEX_COUNT(counter, n) ((void)0)
+#define HEX_TIMER(counter) ((void)0)
+#endif
+
 // implements an undirected graph with positive edge costs
-// using an adjacency matrix representation
+// using a compressed sparse row representation: the neighbors of every vertex are
+// stored next to each other in ascending order, with the cost of each edge beside them,
+// so the memory grows with the number of vertices and edges only.
+// copies of a graph share the same storage until one of them changes an edge.
+// graphs are read from text files or from binary files that hold the storage as it is in memory
 class Graph
 {
+    public:
+    // an edge for building a whole graph at once
+    struct Edge
+    {
+        uint32_t v1, v2;
+        double cost;
+    };
+
+    // the neighbors of a vertex as a view into the storage of the graph
+    // it is valid until an edge of the graph is changed
+    struct Neighbors
+    {
+        const uint32_t* first;
+        const uint32_t* last;
+        inline const uint32_t* begin() const { return first; }
+        inline const uint32_t* end() const { return last; }
+        inline int size() const { return int(last - first); }
+    };
+
     private:
+    // the arrays are either owned or point into a mapped binary graph file, which is read only
+    struct Storage
+    {
+        vector<uint32_t> offsetData, targetData; // the owned arrays, empty for a mapped file
+        vector<double> costData;
+        const uint32_t* offsets; // the neighbors of v are in [offsets[v], offsets[v+1])
+        const uint32_t* targets; // the neighbors of all the vertices, one vertex after the other
+        const double* costs;     // the cost of the edge to each of the targets
+        void* mapping;           // the mapped file, null if the arrays are owned
+        size_t length;
+        vector<char> buffer;     // holds the file on systems without mmap
+
+        Storage() : offsets(nullptr), targets(nullptr), costs(nullptr), mapping(nullptr), length(0) {}
+        Storage(const Storage&) = delete;
+        Storage& operator=(const Storage&) = delete;
+
+        ~Storage()
+        {
+#ifdef HEX_MMAP
+            if (mapping) munmap(mapping, length);
+#endif
+        }
+
+        // point the arrays to the owned data, after it was changed
+        inline void own()
+        {
+            offsets = offsetData.data();
+            targets = targetData.data();
+            costs = costData.data();
+        }
+    };
+
     int V, E;
     const double NOT_CONNECTED;
-    vector< vector<double> > adj_matrix;
+    shared_ptr<Storage> storage;
+
+    static constexpr const char* MAGIC = "HEXGRAPH";
+
+    // gives this graph its own copy of the storage before it gets modified
+    inline Storage& detach()
+    {
+        if (storage.use_count() > 1 || storage->offsetData.empty())
+        {
+            shared_ptr<Storage> copy = make_shared<Storage>();
+            uint32_t n = storage->offsets[V];
+            copy->offsetData.assign(storage->offsets, storage->offsets + V + 1);
+            copy->targetData.assign(storage->targets, storage->targets + n);
+            copy->costData.assign(storage->costs, storage->costs + n);
+            copy->own();
+            storage = copy;
+        }
+        return *storage;
+    }
+
+    // the index of the edge from v1 to v2 in the storage, -1 if there is none
+    inline long find(int v1, int v2) const
+    {
+        const uint32_t* first = storage->targets + storage->offsets[v1];
+        const uint32_t* last  = storage->targets + storage->offsets[v1 + 1];
+        const uint32_t* t = lower_bound(first, last, uint32_t(v2));
+        return (t != last && *t == uint32_t(v2)) ? long(t - storage->targets) : -1;
+    }
+
+    // inserts the edge from v1 to v2 in the row of v1, keeping the row sorted
+    void insert(Storage& s, int v1, int v2, double cost)
+    {
+        const uint32_t* row = s.targetData.data();
+        long i = lower_bound(row + s.offsetData[v1], row + s.offsetData[v1 + 1], uint32_t(v2)) - row;
+        s.targetData.insert(s.targetData.begin() + i, uint32_t(v2));
+        s.costData.insert(s.costData.begin() + i, cost);
+        for (int v = v1 + 1; v <= V; v++) s.offsetData[v]++;
+        s.own();
+    }
+
+    // erases the edge from v1 to v2 from the row of v1, it must exist
+    void erase(Storage& s, int v1, int v2)
+    {
+        long i = find(v1, v2);
+        s.targetData.erase(s.targetData.begin() + i);
+        s.costData.erase(s.costData.begin() + i);
+        for (int v = v1 + 1; v <= V; v++) s.offsetData[v]--;
+        s.own();
+    }
+
+    // builds the storage from a list of edges in O(V+E) with a counting sort of the rows.
+    // negative costs are set to the default value of 1.0, and of repeated edges the last one counts
+    void build(const vector<Edge>& edges)
+    {
+        shared_ptr<Storage> built = make_shared<Storage>();
+        Storage& s = *built;
+
+        // count the edges of every vertex, a loop is stored once
+        s.offsetData.assign(V + 1, 0);
+        for (const Edge& e : edges)
+        {
+            s.offsetData[e.v1 + 1]++;
+            if (e.v1 != e.v2) s.offsetData[e.v2 + 1]++;
+        }
+        for (int v = 0; v < V; v++)
+            s.offsetData[v + 1] += s.offsetData[v];
+
+        // put every edge in the rows of its vertices, in the order of the list
+        s.targetData.resize(s.offsetData[V]);
+        s.costData.resize(s.offsetData[V]);
+        vector<uint32_t> next(s.offsetData.begin(), s.offsetData.end() - 1);
+        for (const Edge& e : edges)
+        {
+            double cost = e.cost < 0 ? 1.0 : e.cost;
+            s.targetData[next[e.v1]] = e.v2;
+            s.costData[next[e.v1]++] = cost;
+            if (e.v1 == e.v2) continue;
+            s.targetData[next[e.v2]] = e.v1;
+            s.costData[next[e.v2]++] = cost;
+        }
+
+        // sort every row and drop the repeated edges, the rows only move towards the front
+        vector< pair<uint32_t, uint32_t> > row; // the target and the position in the list
+        vector<double> rowCosts;
+        uint32_t out = 0;
+        E = 0;
+        for (int v = 0; v < V; v++)
+        {
+            uint32_t first = s.offsetData[v], last = s.offsetData[v + 1];
+            row.clear();
+            rowCosts.assign(s.costData.begin() + first, s.costData.begin() + last);
+            for (uint32_t i = first; i < last; i++)
+                row.push_back(make_pair(s.targetData[i], i - first));
+            sort(row.begin(), row.end());
+            s.offsetData[v] = out;
+            for (size_t i = 0; i < row.size(); i++)
+            {
+                if (i + 1 < row.size() && row[i + 1].first == row[i].first) continue;
+                s.targetData[out] = row[i].first;
+                s.costData[out++] = rowCosts[row[i].second];
+                if (row[i].first >= uint32_t(v)) E++; // count every edge once
+            }
+        }
+        s.offsetData[V] = out;
+        s.targetData.resize(out);
+        s.costData.resize(out);
+        s.targetData.shrink_to_fit();
+        s.costData.shrink_to_fit();
+        s.own();
+        storage = built;
+    }
+
+    // check a binary graph file that is in memory and use its arrays in place
+    bool useBinary(shared_ptr<Storage> file, const string& filename, string& error)
+    {
+        // the header is the magic, the number of vertices, of row entries and of edges
+        const char* data = file->mapping ? static_cast<const char*>(file->mapping) : file->buffer.data();
+        uint64_t header[3];
+        if (file->length < 32)
+        {
+            error = filename + " is truncated";
+            return false;
+        }
+        memcpy(header, data + 8, 24);
+        uint64_t numV = header[0], n = header[1];
+        if (numV >= INT_MAX || n >= UINT32_MAX)
+        {
+            error = filename + " is too large";
+            return false;
+        }
+
+        // the offsets and the targets follow the header, the costs start at the next multiple of 8
+        size_t costsAt = (32 + 4 * (numV + 1 + n) + 7) & ~size_t(7);
+        if (file->length < costsAt + 8 * n)
+        {
+            error = filename + " is truncated";
+            return false;
+        }
+        file->offsets = reinterpret_cast<const uint32_t*>(data + 32);
+        file->targets = file->offsets + numV + 1;
+        file->costs = reinterpret_cast<const double*>(data + costsAt);
+
+        // a damaged file must not send a lookup outside of the arrays
+        bool valid = file->offsets[0] == 0 && file->offsets[numV] == n;
+        for (uint64_t v = 0; v < numV && valid; v++)
+            valid = file->offsets[v] <= file->offsets[v + 1];
+        for (uint64_t i = 0; i < n && valid; i++)
+            valid = file->targets[i] < numV;
+        if (!valid)
+        {
+            error = filename + " is not a valid graph";
+            return false;
+        }
+
+        V = int(numV);
+        E = int(header[2]);
+        storage = file;
+        return true;
+    }
+
+    // parse a text graph: the number of vertices followed by "v w cost" for every edge
+    bool parseText(const char* first, const char* last, const string& filename, string& error)
+    {
+        const char* start = first;
+        auto skip = [&] { while (first != last && isspace((unsigned char)*first)) first++; };
+        auto number = [&](auto& value)
+        {
+            skip();
+            from_chars_result r = from_chars(first, last, value);
+            if (r.ec != errc()) return false;
+            first = r.ptr;
+            return true;
+        };
+
+        long long numV = 0;
+        if (!number(numV) || numV < 0 || numV >= INT_MAX)
+        {
+            error = filename + " does not start with a number of vertices";
+            return false;
+        }
+        vector<Edge> edges;
+        while (skip(), first != last)
+        {
+            long long v = 0, w = 0;
+            double cost = 0.0;
+            const char* at = first;
+            if (!number(v) || !number(w) || !number(cost) || v < 0 || v >= numV || w < 0 || w >= numV)
+            {
+                error = filename + " has an invalid edge at byte " + to_string(at - start);
+                return false;
+            }
+            edges.push_back(Edge{uint32_t(v), uint32_t(w), cost});
+        }
+
+        V = int(numV);
+        build(edges);
+        return true;
+    }
 
     public:
     // constructor for an initially unconnected graph with the given number of vertices
     Graph(int V) :
         V(V), E(0),
         NOT_CONNECTED(-10.0),  // -10.0 signifies a missing edge
-        adj_matrix(vector< vector<double> >(V, vector<double>(V, NOT_CONNECTED))) {}
+        storage(make_shared<Storage>())
+    {
+        storage->offsetData.assign(V + 1, 0);
+        storage->own();
+    }
 
-    // copy constructor
+    // constructor for a graph with the given edges, the fast way to build a large graph
+    Graph(int V, const vector<Edge>& edges) : V(V), E(0), NOT_CONNECTED(-10.0)
+    {
+        build(edges);
+    }
+
+    // copy constructor, the storage is shared and not copied
     Graph(const Graph& other) :
         V(other.V), E(other.E),
         NOT_CONNECTED(other.NOT_CONNECTED),
-        adj_matrix(other.adj_matrix) {}
+        storage(other.storage) {}
 
-    // constructor to initialize the graph from a file
-    Graph(string filename) : E(0), NOT_CONNECTED(-10.0)
+    // constructor to initialize the graph from a file, throws a runtime_error if it can't be read
+    Graph(string filename) : Graph(0)
     {
-        // if we could not open the file exit with an error message
-        ifstream file(filename.c_str());
-        if (!file.is_open())
+        string error;
+        if (!load(filename, error))
+            throw runtime_error(error);
+    }
+
+    // read a graph file, returns false and describes the problem in error if it can't be used.
+    // binary files are recognized by their magic and mapped, their arrays are used without
+    // any parsing; any other file is parsed as text. the graph is unchanged after an error
+    bool load(const string& filename, string& error)
+    {
+        shared_ptr<Storage> file = make_shared<Storage>();
+        const char* data = nullptr;
+#ifdef HEX_MMAP
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0)
         {
-            cout << "Unable to open " << filename << endl;
-            exit(EXIT_FAILURE);
+            if (fd >= 0) close(fd);
+            error = "unable to open " + filename;
+            return false;
         }
+        file->length = size_t(st.st_size);
+        file->mapping = file->length ? mmap(nullptr, file->length, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+        close(fd);
+        if (file->mapping == MAP_FAILED)
+        {
+            file->mapping = nullptr;
+            error = "unable to map " + filename;
+            return false;
+        }
+        data = static_cast<const char*>(file->mapping);
+#else
+        ifstream in(filename.c_str(), ios::binary);
+        if (!in.is_open())
+        {
+            error = "unable to open " + filename;
+            return false;
+        }
+        in.seekg(0, ios::end);
+        file->buffer.resize(size_t(in.tellg()));
+        in.seekg(0, ios::beg);
+        in.read(file->buffer.data(), streamsize(file->buffer.size()));
+        file->length = file->buffer.size();
+        data = file->buffer.data();
+#endif
+        if (file->length >= 8 && memcmp(data, MAGIC, 8) == 0)
+            return useBinary(file, filename, error);
 
-        // read the number of vertices and initialize the adjacency matrix
-        file >> V;
-        adj_matrix = vector< vector<double> >(V, vector<double>(V, NOT_CONNECTED));
-
-        // read and add the edges of the graph
-        int v, w;
-        double cost;
-        while (file >> v >> w >> cost)
-            add(v,w,cost);
+        // the text is only needed while it's parsed, the file is released on return
+        Graph parsed(0);
+        if (!parsed.parseText(data, data + file->length, filename, error)) return false;
+        V = parsed.V;
+        E = parsed.E;
+        storage = parsed.storage;
+        return true;
+    }
 
-        // close the file
-        file.close();
+    // write the graph in the binary format: the magic, the number of vertices, of row entries
+    // and of edges, the offsets and the targets as 32 bit integers and, from the next multiple
+    // of 8 bytes, the costs, all in the byte order of this machine.
+    // returns false and describes the problem in error on failure
+    bool save(const string& filename, string& error) const
+    {
+        uint64_t n = storage->offsets[V];
+        uint64_t header[3] = {uint64_t(V), n, uint64_t(E)};
+        uint64_t padding = 0;
+        ofstream file(filename.c_str(), ios::binary);
+        file.write(MAGIC, 8);
+        file.write(reinterpret_cast<const char*>(header), 24);
+        file.write(reinterpret_cast<const char*>(storage->offsets), streamsize(4 * (V + 1)));
+        file.write(reinterpret_cast<const char*>(storage->targets), streamsize(4 * n));
+        file.write(reinterpret_cast<const char*>(&padding), streamsize(((V + 1 + n) & 1) * 4));
+        file.write(reinterpret_cast<const char*>(storage->costs), streamsize(8 * n));
+        if (!file)
+        {
+            error = "unable to write " + filename;
+            return false;
+        }
+        return true;
     }
 
     // getters for the vertices and edges
@@ -70,48 +504,56 @@ class Graph
     // returns true if an edge between v1 and v2 exists, false otherwise
     inline bool adjacent(int v1, int v2)
     {
-        return adj_matrix[v1][v2] > -1.0; // non existend edges are stored as -10.0
+        return find(v1, v2) >= 0;
     }
 
-    // returns a list containing all the ID's of the neighbors of the given node
-    vector<int> neighbors(int v)
+    // returns the ID's of the neighbors of the given node in ascending order, without copying them
+    inline Neighbors neighbors(int v) const
     {
-        vector<int> vect;
-        for(int i = 0; i < V; i++)
-            if (adjacent(v, i))
-                vect.push_back(i);
-        return vect;
+        const uint32_t* t = storage->targets;
+        return Neighbors{t + storage->offsets[v], t + storage->offsets[v + 1]};
     }
 
     // adds an edge from v1 to v2 if one does not already exist
     // if a cost is provided that will be the new cost of the edge
-    // negative costs will be set to the default value of 1.0
+    // negative costs will be set to the default value of 1.0.
+    // a new edge moves the rows behind it, so large graphs should be built from a list of edges
     inline void add(int v1, int v2, double cost)
     {
-        if (!adjacent(v1,v2)) E++;
-        if (cost < 0)
-            adj_matrix[v1][v2] = adj_matrix[v2][v1] = 1.0;
-        else
-            adj_matrix[v1][v2] = adj_matrix[v2][v1] = cost;
+        if (cost < 0) cost = 1.0;
+        Storage& s = detach();
+        long i = find(v1, v2);
+        if (i >= 0)
+        {
+            s.costData[i] = cost;
+            s.costData[find(v2, v1)] = cost;
+            return;
+        }
+        E++;
+        insert(s, v1, v2, cost);
+        if (v1 != v2) insert(s, v2, v1, cost);
     }
     inline void add(int v1, int v2)
     {
-        if (!adjacent(v1,v2)) E++;
-        adj_matrix[v1][v2] = adj_matrix[v2][v1] = 1.0;
+        add(v1, v2, 1.0);
     }
 
     // removes the edge from v1 to v2 if it exists
     inline void remove(int v1, int v2)
     {
-        if (adjacent(v1,v2)) E--;
-        adj_matrix[v1][v2] = adj_matrix[v2][v1] = NOT_CONNECTED;
+        if (!adjacent(v1,v2)) return;
+        E--;
+        Storage& s = detach();
+        erase(s, v1, v2);
+        if (v1 != v2) erase(s, v2, v1);
     }
 
     // returns the cost of the edge that connects v1 and v2
     // it will return a negative value if they are not connected
     inline double get_cost(int v1, int v2)
     {
-        return adj_matrix[v1][v2];
+        long i = find(v1, v2);
+        return i >= 0 ? storage->costs[i] : NOT_CONNECTED;
     }
 };
 
@@ -142,31 +584,39 @@ inline bool operator==(Color c1, Color c2)
 // also implements monochromatic path finding
 class ColoredGraph : public Graph
 {
+    public:
+    // the monochromatic connected components of a graph, filled by label.
+    // the buffers keep their memory, so labeling again into the same object doesn't allocate
+    struct Components
+    {
+        vector<int> id;           // the component of every node
+        vector<int> size;         // the number of nodes of every component
+        vector<Color> color;      // the color of every component, empty nodes form components too
+        vector<uint32_t> touches; // the terminals every component contains or is adjacent to, one bit each
+        vector<uint32_t> terminal; // scratch: the bit of every node among the terminals
+        vector<int> stack;        // scratch: the nodes found but not yet expanded
+
+        // the number of components
+        inline int count() const { return int(size.size()); }
+
+        // are the two nodes in the same component?
+        inline bool connected(int v1, int v2) const { return id[v1] == id[v2]; }
+    };
+
     protected:
     vector<Color> colors; // store the colors of the nodes
 
     private:
     vector<bool> visited; // the nodes that have been visited for the path finding
-
-    // depth first search to find out if two nodes are monochromatically connected
-    bool dfs(int start, int end)
-    {
-        for (int n : neighbors(start))
-            // only consider unvisited neighbors with the same color
-            if (int(getColor(start)) == int(getColor(n)) && !visited[n])
-            {
-                visited[n] = true;            // mark as visited
-                if (n == end) return true;    // we reached the end
-                if (dfs(n, end)) return true; // a recursive call succeeded
-            }
-
-        return false; // we didn't find it
-    }
+    vector<int> stack;    // the nodes visited but not yet expanded by the path finding
 
     public:
     // initialize a graph with no colors
     ColoredGraph(int size) : Graph(size), colors(size, Color::NONE) {}
 
+    // initialize a graph with the given edges and no colors
+    ColoredGraph(int size, const vector<Graph::Edge>& edges) : Graph(size, edges), colors(size, Color::NONE) {}
+
     // copy constructor
     ColoredGraph(const ColoredGraph& other) : Graph(other), colors(other.colors) {}
 
@@ -177,298 +627,3014 @@ class ColoredGraph : public Graph
     inline void setColor(int index, Color c) { colors[index] = c; }
 
     // are the two nodes connected with a monochromatic path?
+    // a depth first search with an explicit stack, so large graphs can't overflow the call stack
     bool colorConnected(int start, int end)
     {
         // no monochromatic path can exist between nodes of different colors    
         if (getColor(start) != getColor(end)) return false;
 
         // initially only the starting node is visited
-        visited = vector<bool>(getV(), false);
+        visited.assign(getV(), false);
         visited[start] = true;
+        stack.assign(1, start);
+
+        while (!stack.empty())
+        {
+            int v = stack.back();
+            stack.pop_back();
+            for (int n : neighbors(v))
+                // only consider unvisited neighbors with the same color
+                if (int(getColor(v)) == int(getColor(n)) && !visited[n])
+                {
+                    visited[n] = true;         // mark as visited
+                    if (n == end) return true; // we reached the end
+                    stack.push_back(n);
+                }
+        }
+
+        return false; // we didn't find it
+    }
+
+    // label every monochromatic connected component in one pass over the nodes and edges.
+    // the terminals stand for the borders of the graph: they are components of their own
+    // and don't join the components next to them, but bit i of the touches of a component
+    // is set if it is next to terminals[i]. at most 32 terminals
+    void label(Components& c, const vector<int>& terminals)
+    {
+        int V = getV();
+        c.id.assign(V, -1);
+        c.size.clear();
+        c.color.clear();
+        c.touches.clear();
+        c.terminal.assign(V, 0);
+        for (size_t i = 0; i < terminals.size(); i++)
+            c.terminal[terminals[i]] |= uint32_t(1) << i;
+
+        for (int s = 0; s < V; s++)
+        {
+            if (c.id[s] >= 0) continue;
 
-        // run the depth first search and return the result
-        return dfs(start, end);
+            // a new component, flood it from its first node
+            int component = c.count();
+            Color color = getColor(s);
+            int size = 0;
+            uint32_t touches = 0;
+            c.id[s] = component;
+            c.stack.assign(1, s);
+            while (!c.stack.empty())
+            {
+                int v = c.stack.back();
+                c.stack.pop_back();
+                size++;
+                touches |= c.terminal[v];
+                if (c.terminal[v]) continue;
+                for (int n : neighbors(v))
+                {
+                    touches |= c.terminal[n];
+                    if (c.id[n] < 0 && !c.terminal[n] && getColor(n) == color)
+                    {
+                        c.id[n] = component;
+                        c.stack.push_back(n);
+                    }
+                }
+            }
+            c.size.push_back(size);
+            c.color.push_back(color);
+            c.touches.push_back(touches);
+        }
     }
 };
 
 
-// the representation of a hexboard using a graph
-class HexBoard : public ColoredGraph
+// a bit-plane representation of the hex board used for fast winner detection
+// the (x,y) hex is stored in bit y * stride + x, where the stride is size + 1
+// so every row is followed by an always empty padding bit and a stone shifted
+// sideways can never wrap around into the next row.
+// the planes are surrounded by zero guard words, so the shifts can read the
+// words before and after the board without any bounds checks
+class BitBoard
 {
     private:
-    const int size;       // the dimension of the board
-    int numEmpty;         // the number of empty positions
+    // masks of the cells on each side of the board, shared between copies
+    struct Edges
+    {
+        vector<uint64_t> left, right, top, bottom;
+    };
 
-    // the position of the node that represents the (x,y) hex
-    // node zero is the bottom left node, and we store the nodes by row
-    // ^ y
-    //  \             position = y * size + x
-    //   \      x
-    //    0----->
-    inline int pos(int x, int y) { return y * size + x; }
+    int size;       // the dimension of the board
+    int stride;     // the number of bits per row, including the padding bit
+    int words;      // the number of words of the board, a multiple of 4
+    int guard;      // the number of zero words before and after the board
+    shared_ptr<const Edges> edges;
+    vector<uint64_t> blue, red; // one bit-plane per color
 
-    // place a blue or red hex on the board
-    // returns false and does nothing on an invalid move, returns true otherwise
-    bool place(int x, int y, Color c)
+    // the index of the (x,y) bit in a plane
+    inline int bit(int x, int y) const { return y * stride + x; }
+
+    // the word of a plane that stores the given bit
+    inline uint64_t& word(vector<uint64_t>& plane, int b) { return plane[guard + b / 64]; }
+
+    // returns a zeroed plane with the right number of words
+    vector<uint64_t> emptyPlane() const { return vector<uint64_t>(words + 2 * guard, 0); }
+
+    // the stones shifted towards higher (left) or lower (right) bits
+    // q whole words and r bits; reads from the guard words at the ends
+    static inline uint64_t shl(const uint64_t* w, int i, int q, int r)
     {
-        if (x < 0 || x >= size || y < 0 || y >= size || // out of bounds checks
-            int(c) == int(Color::NONE) ||                         // must play blue or red
-            getColor(pos(x,y)) != Color::NONE)          // the position must be empty
-            return false; // invalid move
-        
-        setColor(pos(x,y), c);
-        numEmpty--;
-        return true;      // valid move
+        return r ? (w[i - q] << r) | (w[i - q - 1] >> (64 - r)) : w[i - q];
     }
-
-    // check if someone has won and return his color
-    inline Color getWinner()
+    static inline uint64_t shr(const uint64_t* w, int i, int q, int r)
     {
-        if (colorConnected(size * size, size * size + 1))          // check blue master nodes
-            return Color::BLUE;
-        else if (colorConnected(size * size + 2, size * size + 3)) // check red master nodes
-            return Color::RED;
-        else
-            return Color::NONE;
+        return r ? (w[i + q] >> r) | (w[i + q + 1] << (64 - r)) : w[i + q];
     }
 
-    // plays a move for the given player using a Monte Carlo AI agent with 1000 trials
-    void playAIMove(Color AIColor)
+    // grows the cells reachable from the start edge through the stones of a plane,
+    // dilating by all six hex directions at once until the reach stops growing.
+    // returns true as soon as the reach touches the target edge
+    bool flood(const vector<uint64_t>& stones,
+               const vector<uint64_t>& from, const vector<uint64_t>& to) const
     {
-        vector<int> evaluations(size * size, -1); // the results of the evaluations
-        Color playerColor = (int(AIColor) == int(Color::RED)) ? Color::BLUE : Color::RED;
+        // scratch planes, reused by every flood fill on this thread
+        static thread_local vector<uint64_t> reachBuf, nextBuf;
+        reachBuf.assign(stones.size(), 0);
+        nextBuf.assign(stones.size(), 0);
+        uint64_t* reach = reachBuf.data();
+        uint64_t* next  = nextBuf.data();
+        const uint64_t* s = stones.data();
+        const uint64_t* t = to.data();
 
-        // loop through all positions
-        for (int x = 0; x < size; x++)
-            for (int y = 0; y < size; y++)
-            {
-                // skip occupied positions
-                if (getColor(pos(x,y)) != Color::NONE) continue;
+        // the flood starts from the stones on the first edge
+        bool any = false;
+        for (int i = guard; i < guard + words; i++)
+        {
+            reach[i] = s[i] & from[i];
+            any = any || reach[i];
+        }
+        if (!any) return false;
 
-                // count the number of won games for that position
-                evaluations[pos(x,y)] = 0;
-                for (int i = 0; i < 1000; i++)
-                {
-                    // make a copy of the board and play the x,y position
-                    HexBoard temp(*this);
-                    temp.place(x, y, AIColor);
-
-                    // create an array with the colors to be played and shuffle it
-                    vector<Color> moves(temp.numEmpty, AIColor);
-                    for (int j = 0, n = temp.numEmpty; j < n; j = j + 2)
-                        moves[j] = playerColor;
-                    random_shuffle(moves.begin(), moves.end());
-                    
-                    // place the blocks in the randomly created order
-                    int n = 0;
-                    for (int j = 0; j < size; j++)
-                        for (int k = 0; k < size; k++)
-                            if (temp.place(j, k, moves[n])) n++;
-
-                    // check if the AI won and count it
-                    if (int(temp.getWinner()) == int(AIColor)) evaluations[pos(x,y)] += 1;
-                }
-            }
+        // the three shift amounts of the hex directions split into words and bits
+        const int q1 = 1 / 64,            r1 = 1 % 64;
+        const int q2 = stride / 64,       r2 = stride % 64;
+        const int q3 = (stride + 1) / 64, r3 = (stride + 1) % 64;
 
-        // get the move with the most wins
-        int bestPos = 0;
-        int bestNum = evaluations[0];
-        for (int i = 1; i < size * size; i++)
-            if (evaluations[i] > bestNum)
+        while (true)
+        {
+            bool changed = false, reached = false;
+            int i = guard;
+#ifdef __AVX2__
+            // four words at a time, the unaligned loads handle the carries between words
+            const __m256i zero = _mm256_setzero_si256();
+            __m256i diff = zero, hit = zero;
+            const __m128i c1 = _mm_cvtsi32_si128(r1), c1n = _mm_cvtsi32_si128(64 - r1);
+            const __m128i c2 = _mm_cvtsi32_si128(r2), c2n = _mm_cvtsi32_si128(64 - r2);
+            const __m128i c3 = _mm_cvtsi32_si128(r3), c3n = _mm_cvtsi32_si128(64 - r3);
+            #define HEX_LOAD(p) _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))
+            #define HEX_SHL(q, c, cn) _mm256_or_si256(_mm256_sll_epi64(HEX_LOAD(reach + i - (q)), c), \
+                                                      _mm256_srl_epi64(HEX_LOAD(reach + i - (q) - 1), cn))
+            #define HEX_SHR(q, c, cn) _mm256_or_si256(_mm256_srl_epi64(HEX_LOAD(reach + i + (q)), c), \
+                                                      _mm256_sll_epi64(HEX_LOAD(reach + i + (q) + 1), cn))
+            for (; i < guard + words; i += 4)
             {
-                bestNum = evaluations[i];
-                bestPos = i;
+                // a shift by 64 bits yields zero, so whole word shifts need no special case
+                __m256i cur = HEX_LOAD(reach + i);
+                __m256i n = _mm256_or_si256(cur, _mm256_or_si256(HEX_SHL(q1, c1, c1n), HEX_SHR(q1, c1, c1n)));
+                n = _mm256_or_si256(n, _mm256_or_si256(HEX_SHL(q2, c2, c2n), HEX_SHR(q2, c2, c2n)));
+                n = _mm256_or_si256(n, _mm256_or_si256(HEX_SHL(q3, c3, c3n), HEX_SHR(q3, c3, c3n)));
+                n = _mm256_and_si256(n, HEX_LOAD(s + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(next + i), n);
+                diff = _mm256_or_si256(diff, _mm256_xor_si256(n, cur));
+                hit  = _mm256_or_si256(hit, _mm256_and_si256(n, HEX_LOAD(t + i)));
             }
-
-        // play the best position
-        place(bestPos % size, bestPos / size, AIColor);
+            #undef HEX_SHR
+            #undef HEX_SHL
+            #undef HEX_LOAD
+            changed = !_mm256_testz_si256(diff, diff);
+            reached = !_mm256_testz_si256(hit, hit);
+#else
+            for (; i < guard + words; i++)
+            {
+                uint64_t n = reach[i]
+                    | shl(reach, i, q1, r1) | shr(reach, i, q1, r1)
+                    | shl(reach, i, q2, r2) | shr(reach, i, q2, r2)
+                    | shl(reach, i, q3, r3) | shr(reach, i, q3, r3);
+                n &= s[i];
+                changed = changed || n != reach[i];
+                reached = reached || (n & t[i]);
+                next[i] = n;
+            }
+#endif
+            if (reached) return true;
+            if (!changed) return false;
+            swap(reach, next);
+        }
     }
 
-    // print the board
-    void print()
+    public:
+    // an empty board of the given dimension
+    BitBoard(int size) : size(size), stride(size + 1)
     {
-        // print top down by row
-        for (int y = size - 1; y > 0; y--)
+        words = ((size * stride + 63) / 64 + 3) / 4 * 4;
+        guard = (stride + 1) / 64 + 4; // enough for the longest shift and a full vector load
+
+        Edges e;
+        e.left = e.right = e.top = e.bottom = emptyPlane();
+        for (int i = 0; i < size; i++)
         {
-            // print 2*(size-y) spaces at the start of each row
-            for (int x = 0; x < 2 * (size - y - 1); x++) cout << " ";
-            // print the row number
-            cout << setw(3) << left << y;
-            // print the colors for the row
-            for (int x = 0; x < size - 1; x++) cout << getColor(pos(x,y)) << " - ";
-            cout << getColor(pos(size-1,y)) << endl;
-            // print the spaces at the start of the intermediate row
-            for (int x = 0; x < 2 * (size - y) + 1; x++) cout << " ";
-            // print the intermediate row \ / \ /
-            for (int x = 0; x < size - 1; x++) cout << " \\ /";
-            cout << " \\" << endl;
+            word(e.left,   bit(0, i))        |= uint64_t(1) << (bit(0, i) % 64);
+            word(e.right,  bit(size - 1, i)) |= uint64_t(1) << (bit(size - 1, i) % 64);
+            word(e.bottom, bit(i, 0))        |= uint64_t(1) << (bit(i, 0) % 64);
+            word(e.top,    bit(i, size - 1)) |= uint64_t(1) << (bit(i, size - 1) % 64);
         }
-        // print the 0th row's spaces
-        for (int x = 0; x < 2 * size - 2; x++) cout << " ";
-        // print the 0th row's number
-        cout << "0  ";
-        // print the 0th row
-        for (int x = 0; x < size - 1; x++) cout << getColor(pos(x,0)) << " - ";
-        cout << getColor(pos(size-1,0)) << endl;
-        // print the spaces before the column numbers
-        for (int x = 0; x < 2 * size - 2; x++) cout << " ";
-        // print the column numbers
-        cout << "   ";
-        for (int x = 0; x < size; x++) cout << setw(4) << left << x;
-        cout << endl;
+        edges = make_shared<const Edges>(e);
+        blue = red = emptyPlane();
     }
- 
-    public:
-    // initiate a size*size graph to represent the board
-    // we will use four additional nodes to help determine if a player has won
-    HexBoard(int size) : ColoredGraph(size * size + 4), size(size), numEmpty(size * size)
+
+    // remove all the stones
+    inline void clear()
     {
-        // connect all adjacent positions
-        for (int x = 0; x < size; x++)
-            for (int y = 0; y < size; y++)
-            {
-                if (x < size-1)               add(pos(x,y), pos(x+1,y));   // right
-                if (x > 0)                    add(pos(x,y), pos(x-1,y));   // left
-                if (y < size-1)               add(pos(x,y), pos(x,y+1));   // top
-                if (y > 0)                    add(pos(x,y), pos(x,y-1));   // bottom
-                if (x < size-1 && y < size-1) add(pos(x,y), pos(x+1,y+1)); // top right
-                if (x > 0 && y > 0)           add(pos(x,y), pos(x-1,y-1)); // bottom left
-            }
-        
-        // we will add a master node on each side of the board
-        // and connect it with all the nodes in the side
-        // this way we only have to check if the master nodes are connected
-        // to determine if a player has won
+        std::fill(blue.begin(), blue.end(), 0);
+        std::fill(red.begin(), red.end(), 0);
+    }
 
-        // left and right sides are blue
-        setColor(size * size,     Color::BLUE); // left master node
-        setColor(size * size + 1, Color::BLUE); // right master node 
+    // set the (x,y) hex to the given color
+    inline void set(int x, int y, Color c)
+    {
+        int b = bit(x, y);
+        uint64_t m = uint64_t(1) << (b % 64);
+        word(blue, b) &= ~m;
+        word(red, b)  &= ~m;
+        if (c == Color::BLUE)     word(blue, b) |= m;
+        else if (c == Color::RED) word(red, b)  |= m;
+    }
+
+    // the color whose stones connect its two sides of the board, if any
+    Color winner() const
+    {
+        HEX_COUNT(WINNER_CHECKS, 1);
+        if (flood(blue, edges->left, edges->right)) // blue connects left to right
+            return Color::BLUE;
+        else if (flood(red, edges->bottom, edges->top)) // red connects bottom to top
+            return Color::RED;
+        else
+            return Color::NONE;
+    }
+};
+
+
+// a disjoint-set forest with path compression and union by rank
+// used to keep track of the connected groups of stones as they are placed
+class DisjointSet
+{
+    private:
+    vector<int> parent; // the parent of each element, roots are their own parents
+    vector<int> rank;   // an upper bound on the height of each root's tree
+
+    public:
+    // every element starts in its own set
+    DisjointSet(int n) : parent(n), rank(n, 0)
+    {
+        for (int i = 0; i < n; i++)
+            parent[i] = i;
+    }
+
+    // the representative of the set containing v
+    // compresses the path on the way up by pointing nodes to their grandparents
+    inline int find(int v)
+    {
+        while (parent[v] != v)
+        {
+            parent[v] = parent[parent[v]];
+            v = parent[v];
+        }
+        return v;
+    }
+
+    // merges the sets of v and w, hanging the shallower tree below the deeper one
+    inline void unite(int v, int w)
+    {
+        v = find(v);
+        w = find(w);
+        if (v == w) return;
+        if (rank[v] < rank[w]) swap(v, w);
+        parent[w] = v;
+        if (rank[v] == rank[w]) rank[v]++;
+    }
+
+    // are v and w in the same set?
+    inline bool connected(int v, int w) { return find(v) == find(w); }
+
+    // put every element back in its own set
+    void reset()
+    {
+        for (int i = 0; i < int(parent.size()); i++)
+            parent[i] = i;
+        std::fill(rank.begin(), rank.end(), 0);
+    }
+};
+
+
+// a fixed set of worker threads that share the iterations of parallel loops
+// the threads are started once and sleep between loops, so a pool can be
+// reused for every AI move without paying for thread creation
+class WorkerPool
+{
+    private:
+    vector<thread> threads;
+    mutex lock;
+    condition_variable wake, finished;
+    const function<void(int, int)>* job; // the body of the running loop
+    int items;                           // the number of iterations of the running loop
+    atomic<int> next;                    // the next iteration to hand out
+    int busy;                            // the threads that have not finished the running loop
+    unsigned generation;                 // incremented for every new loop
+    bool quit;
+
+    // run iterations of the current loop until there are none left
+    void work(int id)
+    {
+        for (int i = next++; i < items; i = next++)
+            (*job)(i, id);
+    }
+
+    // the main loop of the worker threads
+    void loop(int id)
+    {
+        unsigned seen = 0;
+        while (true)
+        {
+            {
+                unique_lock<mutex> l(lock);
+                wake.wait(l, [&] { return quit || generation != seen; });
+                if (quit) return;
+                seen = generation;
+            }
+            work(id);
+            lock_guard<mutex> l(lock);
+            if (--busy == 0) finished.notify_one();
+        }
+    }
+
+    public:
+    // a pool with the given total number of threads, including the calling thread
+    WorkerPool(int numThreads) : job(nullptr), items(0), next(0), busy(0), generation(0), quit(false)
+    {
+        for (int i = 1; i < numThreads; i++)
+            threads.emplace_back(&WorkerPool::loop, this, i);
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool()
+    {
+        {
+            lock_guard<mutex> l(lock);
+            quit = true;
+        }
+        wake.notify_all();
+        for (thread& t : threads) t.join();
+    }
+
+    // the number of threads that take part in a loop
+    inline int size() const { return int(threads.size()) + 1; }
+
+    // call f(i, thread id) for every i in [0, n) and wait for all of them
+    // the calling thread works as thread 0, the thread ids go up to size() - 1
+    void run(int n, const function<void(int, int)>& f)
+    {
+        {
+            lock_guard<mutex> l(lock);
+            job = &f;
+            items = n;
+            next = 0;
+            busy = int(threads.size());
+            generation++;
+        }
+        wake.notify_all();
+        work(0);
+        unique_lock<mutex> l(lock);
+        finished.wait(l, [&] { return busy == 0; });
+    }
+};
+
+// scrambles a 64 bit value, used to derive independent seeds from a single one
+inline uint64_t mixSeed(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// the random generator of the playouts, xoshiro256** seeded through mixSeed.
+// every search and every playout batch gets its own generator from an explicit seed,
+// so the threads never share one and a fixed seed repeats a run exactly
+class Random
+{
+    private:
+    uint64_t s[4];
+
+    static inline uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    public:
+    typedef uint64_t result_type;
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return UINT64_MAX; }
+
+    Random(uint64_t seed = 0) { this->seed(seed); }
+
+    // start the sequence of the given seed, different seeds give unrelated sequences
+    void seed(uint64_t seed)
+    {
+        for (int i = 0; i < 4; i++)
+            s[i] = mixSeed(seed + uint64_t(i) * 0x9e3779b97f4a7c15ULL);
+    }
+
+    // the next 64 random bits
+    inline uint64_t operator()()
+    {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // a uniform random number in [0, n) for n > 0, with Lemire's multiply and reject
+    // method; the division only runs in the rare case that the result may be biased
+    inline uint32_t below(uint32_t n)
+    {
+        uint64_t m = uint64_t(uint32_t((*this)() >> 32)) * n;
+        if (uint32_t(m) < n)
+        {
+            uint32_t threshold = uint32_t(-n) % n;
+            while (uint32_t(m) < threshold)
+                m = uint64_t(uint32_t((*this)() >> 32)) * n;
+        }
+        return uint32_t(m >> 32);
+    }
+
+    // put the elements of a range in a random order with a Fisher-Yates shuffle
+    template <class Iterator>
+    void shuffle(Iterator first, Iterator last)
+    {
+        for (uint32_t n = uint32_t(last - first); n > 1; n--)
+            swap(first[n - 1], first[below(n)]);
+    }
+};
+
+
+// runs many random playouts of one position at once, bit-sliced: every cell of the board
+// holds a few lane words where bit k is set if the cell is blue in the k-th game.
+// the empty cells are filled one by one, every game draws its own random numbers and
+// makes a cell blue with the chance that its blue stones left have among its cells left,
+// so every game is an independent uniform random fill just like HexBoard::randomFill,
+// and the winners of all the games come from a single flood fill that works on all the
+// lanes together. the board is full, so blue wins the games where
+// it connects left to right and red wins the others.
+// the cells are kept with a border of one cell around the board, so every cell has its
+// six neighbors at fixed offsets; the left border is reached in every game and the
+// other borders are never reached
+class PlayoutKernel
+{
+    public:
+#ifdef __AVX2__
+    static const int WORDS = 4; // the lane words per cell, one AVX2 register
+#else
+    static const int WORDS = 1;
+#endif
+    static const int LANES = 64 * WORDS; // the games played by every call of play
+
+    private:
+    int size;              // the dimension of the board
+    int stride;            // the cells per row, including the border on both sides
+    vector<uint64_t> base; // the lane words of the position, all ones on blue stones
+    vector<int> empty;     // the empty cells of the position, with the border
+    vector<uint64_t> blue, reach;  // the games and the flood
+    vector<uint64_t> left, draw;   // the bit-sliced blue stones left to place and random numbers of every game
+
+#ifdef __AVX2__
+    typedef __m256i Lanes;
+    static inline Lanes load(const uint64_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static inline void store(uint64_t* p, Lanes v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static inline Lanes both(Lanes a, Lanes b) { return _mm256_and_si256(a, b); }
+    static inline Lanes either(Lanes a, Lanes b) { return _mm256_or_si256(a, b); }
+    static inline Lanes differ(Lanes a, Lanes b) { return _mm256_xor_si256(a, b); }
+    static inline Lanes except(Lanes a, Lanes b) { return _mm256_andnot_si256(b, a); }
+    static inline bool none(Lanes a) { return _mm256_testz_si256(a, a); }
+    static inline Lanes zero() { return _mm256_setzero_si256(); }
+    static inline Lanes ones() { return _mm256_set1_epi64x(-1); }
+#else
+    typedef uint64_t Lanes;
+    static inline Lanes load(const uint64_t* p) { return *p; }
+    static inline void store(uint64_t* p, Lanes v) { *p = v; }
+    static inline Lanes both(Lanes a, Lanes b) { return a & b; }
+    static inline Lanes either(Lanes a, Lanes b) { return a | b; }
+    static inline Lanes differ(Lanes a, Lanes b) { return a ^ b; }
+    static inline Lanes except(Lanes a, Lanes b) { return a & ~b; }
+    static inline bool none(Lanes a) { return a == 0; }
+    static inline Lanes zero() { return 0; }
+    static inline Lanes ones() { return ~uint64_t(0); }
+#endif
+
+    // the cell of the (x,y) hex, with the border
+    inline int cell(int x, int y) const { return (y + 1) * stride + x + 1; }
+
+    // one sweep of the flood over the board, forwards or backwards, the cells
+    // read the reach their neighbors got earlier in the same sweep.
+    // returns the lanes whose reach changed
+    Lanes sweep(bool forward)
+    {
+        const int right = WORDS, up = stride * WORDS, upRight = (stride + 1) * WORDS;
+        Lanes changed = zero();
+        for (int i = 0; i < size; i++)
+        {
+            int y = forward ? i : size - 1 - i;
+            for (int j = 0; j < size; j++)
+            {
+                int x = forward ? j : size - 1 - j;
+                uint64_t* r = &reach[cell(x, y) * WORDS];
+                Lanes old = load(r);
+                Lanes n = either(either(old, either(load(r - right), load(r + right))),
+                                 either(either(load(r - up), load(r + up)),
+                                        either(load(r - upRight), load(r + upRight))));
+                n = both(n, load(&blue[cell(x, y) * WORDS]));
+                changed = either(changed, differ(n, old));
+                store(r, n);
+            }
+        }
+        return changed;
+    }
+
+    public:
+    // a kernel for boards of the given dimension, the cells are numbered like HexBoard::pos
+    PlayoutKernel(int size) : size(size), stride(size + 2),
+        base((size + 2) * (size + 2) * WORDS, 0), blue(base), reach(base) {}
+
+    // set the position the games start from, colors holds the color of every cell
+    void setPosition(const vector<Color>& colors)
+    {
+        empty.clear();
+        for (int p = 0; p < size * size; p++)
+        {
+            int c = cell(p % size, p / size);
+            std::fill(&base[c * WORDS], &base[c * WORDS] + WORDS, colors[p] == Color::BLUE ? ~uint64_t(0) : 0);
+            if (colors[p] == Color::NONE) empty.push_back(c);
+        }
+        int bits = 1;
+        while ((size_t(1) << bits) <= empty.size()) bits++;
+        left.assign(bits * WORDS, 0);
+        draw.assign(bits * WORDS, 0);
+    }
+
+    // fill the empty cells in LANES games with alternating moves where toMove plays first,
+    // and return the number of games won by the given color
+    int play(Color toMove, Color winner, Random& rng)
+    {
+        HEX_TIMER(PLAYOUT_NS);
+        HEX_COUNT(PLAYOUTS, LANES);
+        HEX_COUNT(KERNEL_BATCHES, 1);
+        // every game places the same number of blue stones, the player to move gets the extra one
+        blue = base;
+        int m = int(empty.size());
+        int bits = int(left.size()) / WORDS;
+        uint32_t target = (toMove == Color::BLUE) ? (m + 1) / 2 : m / 2;
+        for (int k = 0; k < bits; k++)
+            std::fill(&left[k * WORDS], &left[k * WORDS] + WORDS, (target >> k) & 1 ? ~uint64_t(0) : 0);
+
+        // fill the cells one by one: with n cells left, every game draws its own number
+        // below n and the cell is blue if the number is below the blue stones the game has left
+        uint64_t random[WORDS];
+        for (int i = 0; i < m; i++)
+        {
+            uint32_t n = uint32_t(m - i);
+            int width = 0;
+            while ((uint32_t(1) << width) < n) width++;
+
+            // random numbers of width bits, drawn again in the games where they are n or more
+            Lanes redraw = ones();
+            do
+            {
+                for (int k = 0; k < width; k++)
+                {
+                    for (int w = 0; w < WORDS; w++) random[w] = rng();
+                    uint64_t* d = &draw[k * WORDS];
+                    store(d, either(except(load(d), redraw), both(load(random), redraw)));
+                }
+                if ((uint32_t(1) << width) == n) break;
+
+                // compare with n from the highest bit down
+                Lanes below = zero(), equal = ones();
+                for (int k = width - 1; k >= 0; k--)
+                {
+                    Lanes d = load(&draw[k * WORDS]);
+                    if ((n >> k) & 1)
+                    {
+                        below = either(below, except(equal, d));
+                        equal = both(equal, d);
+                    }
+                    else
+                        equal = except(equal, d);
+                }
+                redraw = except(ones(), below);
+            }
+            while (!none(redraw));
+
+            // the games whose number is below the stones they have left, from the borrow of draw - left
+            Lanes borrow = zero();
+            for (int k = 0; k < bits; k++)
+            {
+                Lanes d = k < width ? load(&draw[k * WORDS]) : zero();
+                Lanes l = load(&left[k * WORDS]);
+                borrow = either(except(l, d), except(borrow, differ(d, l)));
+            }
+            store(&blue[empty[i] * WORDS], borrow);
+
+            // and they have one stone less left
+            for (int k = 0; k < bits && !none(borrow); k++)
+            {
+                Lanes l = load(&left[k * WORDS]);
+                store(&left[k * WORDS], differ(l, borrow));
+                borrow = except(borrow, l);
+            }
+        }
+
+        // flood all the games from the left side through the blue stones, alternating
+        // the direction of the sweeps until the reach stops growing
+        std::fill(reach.begin(), reach.end(), 0);
+        for (int y = 0; y < size; y++)
+            store(&reach[cell(-1, y) * WORDS], ones());
+        Lanes changed;
+        do
+        {
+            changed = sweep(true);
+            changed = either(changed, sweep(false));
+        }
+        while (!none(changed));
+        Lanes right = zero();
+        for (int y = 0; y < size; y++)
+            right = either(right, load(&reach[cell(size - 1, y) * WORDS]));
+        uint64_t won[WORDS]; // the lanes won by blue
+        store(won, right);
+
+        int blueWins = 0;
+        for (int w = 0; w < WORDS; w++) blueWins += __builtin_popcountll(won[w]);
+        return winner == Color::BLUE ? blueWins : LANES - blueWins;
+    }
+};
+
+
+// an opening book: the best moves of positions that were searched offline with a large budget
+// the file is an 8 byte magic, the number of entries and the entries sorted by key,
+// in the byte order of the machine that wrote it. it is memory mapped and searched
+// in place, so loading costs nothing and the pages are shared between processes
+class OpeningBook
+{
+    public:
+    struct Entry
+    {
+        uint64_t key; // the hash of the position and the player to move
+        int32_t move; // the position of the best move
+        float value;  // the winning rate of the best move in the offline search
+    };
+
+    private:
+    const Entry* entries; // the sorted entries, inside the mapping
+    size_t count;
+    void* mapping;        // the mapped file, null if nothing is mapped
+    size_t length;
+    vector<char> buffer;  // holds the file on systems without mmap
+
+    static constexpr const char* MAGIC = "HEXBOOK2"; // the keys and moves are canonical since version 2
+
+    public:
+    OpeningBook() : entries(nullptr), count(0), mapping(nullptr), length(0) {}
+
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+
+    ~OpeningBook()
+    {
+#ifdef HEX_MMAP
+        if (mapping) munmap(mapping, length);
+#endif
+    }
+
+    // the number of positions in the book
+    inline size_t size() const { return count; }
+
+    // map a book file, returns false and describes the problem in error if it can't be used
+    bool load(const string& filename, string& error)
+    {
+        const char* data = nullptr;
+#ifdef HEX_MMAP
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0)
+        {
+            if (fd >= 0) close(fd);
+            error = "unable to open " + filename;
+            return false;
+        }
+        length = size_t(st.st_size);
+        mapping = length ? mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+        close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            mapping = nullptr;
+            error = "unable to map " + filename;
+            return false;
+        }
+        data = static_cast<const char*>(mapping);
+#else
+        ifstream file(filename.c_str(), ios::binary);
+        if (!file.is_open())
+        {
+            error = "unable to open " + filename;
+            return false;
+        }
+        buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        length = buffer.size();
+        data = buffer.data();
+#endif
+        // check the header and that the entries fit in the file
+        uint64_t n = 0;
+        if (length < 16 || memcmp(data, MAGIC, 8) != 0)
+        {
+            error = filename + " is not an opening book";
+            return false;
+        }
+        memcpy(&n, data + 8, 8);
+        if (n > (length - 16) / sizeof(Entry))
+        {
+            error = filename + " is truncated";
+            return false;
+        }
+        entries = reinterpret_cast<const Entry*>(data + 16);
+        count = size_t(n);
+        return true;
+    }
+
+    // the book move for a position key, or -1 if the position is not in the book
+    int find(uint64_t key) const
+    {
+        const Entry* e = lower_bound(entries, entries + count, key,
+                                     [](const Entry& a, uint64_t k) { return a.key < k; });
+        return (e != entries + count && e->key == key) ? e->move : -1;
+    }
+
+    // write a book file with the given entries, returns false and describes the problem in error on failure
+    static bool save(const string& filename, vector<Entry> book, string& error)
+    {
+        sort(book.begin(), book.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+        ofstream file(filename.c_str(), ios::binary);
+        uint64_t n = book.size();
+        file.write(MAGIC, 8);
+        file.write(reinterpret_cast<const char*>(&n), 8);
+        file.write(reinterpret_cast<const char*>(book.data()), streamsize(book.size() * sizeof(Entry)));
+        if (!file)
+        {
+            error = "unable to write " + filename;
+            return false;
+        }
+        return true;
+    }
+};
+
+
+// the AI engines that can play a move on a hex board
+enum class Engine { FLAT, MCTS, AMAF };
+
+class MCTS;
+class TranspositionTable;
+class GtpServer;
+class Benchmark;
+
+// the representation of a hexboard using a graph
+class HexBoard : public ColoredGraph
+{
+    private:
+    const int size;       // the dimension of the board
+    int numEmpty;         // the number of empty positions
+    uint64_t hash;        // the zobrist hash of the stones, updated by place
+    uint64_t rotatedHash; // the hash of the position rotated by 180 degrees, updated by place
+    int lastMove;         // the position of the last stone placed by place, -1 if there is none
+    BitBoard bits;        // the stones as bit-planes for fast winner checks
+    DisjointSet groups;   // the connected groups of stones, including the master nodes
+    shared_ptr<WorkerPool> pool; // the threads for the AI, null to run on the calling thread
+    Engine engine;        // the AI engine used by playAIMove
+    int playouts;         // the playouts per move of every tree of the tree search and of the AMAF engine
+    int moveTime;         // the milliseconds per AI move, 0 to use fixed playout counts
+    vector< shared_ptr<MCTS> > trees; // the search trees kept between moves, one per thread, copies start without them
+    shared_ptr<TranspositionTable> table; // the transposition table of all the trees, copies start without it
+    int hashSize;         // the megabytes of the transposition table of the tree search
+    shared_ptr<const OpeningBook> book; // the precomputed opening moves, shared by copies
+    long long playoutCount; // the playouts run by the AI on this board so far
+    bool pondering;       // search on the opponent's time while waiting for input
+    thread ponderer;      // the background search while pondering
+    Random rng;           // draws the seeds of the AI's searches
+
+    friend class MCTS;
+    friend class GtpServer;
+    friend class Benchmark;
+
+    static const int TRIALS  = 1000; // the random playouts per evaluated position, rounded up to whole kernel batches
+    static const int PRUNE   = 2;    // the flat engine skips positions that are further off a shortest connection
+    static const int AMAF_BATCH = 256; // the playouts of a task of the AMAF engine
+    static const int FLAT_TRIALS = (TRIALS + PlayoutKernel::LANES - 1) / PlayoutKernel::LANES * PlayoutKernel::LANES; // the trials actually run
+    static const int RAVE_EQUIV = 1000; // the direct playouts at which both statistics of a position weigh the same
+    static const int MATCH_HASH = 8;    // the most megabytes of the transposition table of a side in a match game
+
+    // the position of the node that represents the (x,y) hex
+    // node zero is the bottom left node, and we store the nodes by row
+    // ^ y
+    //  \             position = y * size + x
+    //   \      x
+    //    0----->
+    inline int pos(int x, int y) { return y * size + x; }
+
+    // the zobrist key of a stone of the given color on position p
+    // the keys are derived from a fixed formula, so hashes are the same in every run;
+    // position -1 gives the keys that tell whose move led to a position
+    static inline uint64_t zobrist(int p, Color c)
+    {
+        return mixSeed((uint64_t(p + 1) << 2) | uint64_t(c));
+    }
+
+    // the position of the (x,y) hex after a 180 degree rotation of the board, (size-1-x, size-1-y).
+    // the rotation keeps the sides of both players, so rotated positions are equivalent
+    inline int rotate(int p) const { return size * size - 1 - p; }
+
+    // is the position the same after a 180 degree rotation? the hashes rule out almost
+    // every other position, the colors make sure
+    bool symmetric()
+    {
+        if (hash != rotatedHash) return false;
+        for (int p = 0; p < size * size / 2; p++)
+            if (getColor(p) != getColor(rotate(p))) return false;
+        return true;
+    }
+
+    // the hash of the position or of its rotation, whichever is smaller, so both share it.
+    // the orientation with the smaller hash is the canonical one
+    inline uint64_t canonicalHash() const { return min(hash, rotatedHash); }
+
+    // place a blue or red hex on the board
+    // returns false and does nothing on an invalid move, returns true otherwise
+    bool place(int x, int y, Color c)
+    {
+        if (x < 0 || x >= size || y < 0 || y >= size || // out of bounds checks
+            int(c) == int(Color::NONE) ||                         // must play blue or red
+            getColor(pos(x,y)) != Color::NONE)          // the position must be empty
+            return false; // invalid move
+        
+        setColor(pos(x,y), c);
+        bits.set(x, y, c);
+        join(x, y, c);
+        hash ^= zobrist(pos(x,y), c);
+        rotatedHash ^= zobrist(rotate(pos(x,y)), c);
+        lastMove = pos(x,y);
+        numEmpty--;
+        if (!trees.empty()) advanceTree(pos(x,y));
+        return true;      // valid move
+    }
+
+    // move the roots of the search trees to the position that was just played
+    // defined after the MCTS class
+    void advanceTree(int p);
+
+    // create a search tree for every thread of the pool unless they exist, they share
+    // the transposition table and split the node cap evenly
+    void makeTrees();
+
+    // search the position where toMove plays next on all the trees, in parallel on the
+    // pool, and return the move with the most visits at their roots together
+    int searchTrees(Color toMove, int numPlayouts, chrono::steady_clock::time_point deadline);
+
+    // search the current position in the background until stopPondering is called
+    // the statistics stay in the tree for the AI's next move, defined after the MCTS class
+    void startPondering(Color toMove);
+    void stopPondering();
+
+    // merge the group of the (x,y) hex with its neighbors of the same color
+    // the master nodes are the neighbors of the hexes on their side
+    void join(int x, int y, Color c)
+    {
+        int p = pos(x,y);
+        if (x < size-1 && getColor(pos(x+1,y)) == c)                 groups.unite(p, pos(x+1,y));   // right
+        if (x > 0 && getColor(pos(x-1,y)) == c)                      groups.unite(p, pos(x-1,y));   // left
+        if (y < size-1 && getColor(pos(x,y+1)) == c)                 groups.unite(p, pos(x,y+1));   // top
+        if (y > 0 && getColor(pos(x,y-1)) == c)                      groups.unite(p, pos(x,y-1));   // bottom
+        if (x < size-1 && y < size-1 && getColor(pos(x+1,y+1)) == c) groups.unite(p, pos(x+1,y+1)); // top right
+        if (x > 0 && y > 0 && getColor(pos(x-1,y-1)) == c)           groups.unite(p, pos(x-1,y-1)); // bottom left
+
+        if (c == Color::BLUE)
+        {
+            if (x == 0)      groups.unite(p, size * size);     // left master node
+            if (x == size-1) groups.unite(p, size * size + 1); // right master node
+        }
+        else
+        {
+            if (y == size-1) groups.unite(p, size * size + 2); // top master node
+            if (y == 0)      groups.unite(p, size * size + 3); // bottom master node
+        }
+    }
+
+    // place a stone during a random playout
+    // only the colors and the bit-planes are updated, the groups and the hash go stale,
+    // so use it on throwaway copies and get the result from bits.winner()
+    inline bool fill(int x, int y, Color c)
+    {
+        if (getColor(pos(x,y)) != Color::NONE) return false;
+        setColor(pos(x,y), c);
+        bits.set(x, y, c);
+        numEmpty--;
+        return true;
+    }
+
+    // check if someone has won and return his color
+    // the groups are updated on every move so this is just two lookups
+    inline Color getWinner()
+    {
+        if (groups.connected(size * size, size * size + 1))          // check blue master nodes
+            return Color::BLUE;
+        else if (groups.connected(size * size + 2, size * size + 3)) // check red master nodes
+            return Color::RED;
+        else
+            return Color::NONE;
+    }
+
+    // the distances from a master node to every node for the player of the given color:
+    // entering an empty hex costs 1, the player's stones and master nodes cost nothing
+    // and the opponent's are blocked. a 0-1 breadth first search that finishes one
+    // distance before it starts the next; unreachable nodes get size * size + 1
+    void distances(int source, Color c, vector<int>& dist, vector<int>& layer, vector<int>& next)
+    {
+        Color opponent = (c == Color::BLUE) ? Color::RED : Color::BLUE;
+        dist.assign(size * size + 4, size * size + 1);
+        dist[source] = 0;
+        layer.assign(1, source);
+        for (int d = 0; !layer.empty(); d++)
+        {
+            next.clear();
+            for (size_t i = 0; i < layer.size(); i++)
+            {
+                int v = layer[i];
+                if (dist[v] != d) continue; // it was reached again with a shorter distance
+                for (int n : neighbors(v))
+                {
+                    Color nc = getColor(n);
+                    if (nc == opponent) continue;
+                    int nd = (nc == Color::NONE) ? d + 1 : d;
+                    if (nd >= dist[n]) continue;
+                    dist[n] = nd;
+                    (nd == d ? layer : next).push_back(n);
+                }
+            }
+            layer.swap(next);
+        }
+    }
+
+    // the colors around the (x,y) hex in circular order, where two neighbors in a row are
+    // always adjacent; the sides of the board count as stones of their player. returns false
+    // for the two corners with a neighbor outside of both sides, where that is ambiguous
+    bool ring(int x, int y, Color around[6])
+    {
+        static const int dx[6] = {1, 1, 0, -1, -1, 0};
+        static const int dy[6] = {0, 1, 1, 0, -1, -1};
+        for (int d = 0; d < 6; d++)
+        {
+            int nx = x + dx[d], ny = y + dy[d];
+            bool outX = nx < 0 || nx >= size, outY = ny < 0 || ny >= size;
+            if (outX && outY) return false;
+            around[d] = outX ? Color::BLUE : outY ? Color::RED : getColor(pos(nx,ny));
+        }
+        return true;
+    }
+
+    // is the empty position p dead, so that its color can't change the winner? it is if
+    // one player has four or more neighbors in a row around it: they are connected already
+    // and the other two neighbors are adjacent, so neither player needs a path through it.
+    // it is as well if it has no empty neighbors and each player's neighbors are in one row.
+    // fill gets the color it can be filled with
+    bool dead(int p, Color& fill)
+    {
+        Color around[6];
+        if (!ring(p % size, p / size, around)) return false;
+
+        // find the rows of equal colors around the position
+        int runs[3] = {0, 0, 0};
+        for (int d = 0; d < 6; d++)
+        {
+            if (around[d] == around[(d + 5) % 6]) continue; // not the start of a row
+            int length = 1;
+            while (length < 6 && around[(d + length) % 6] == around[d]) length++;
+            runs[int(around[d])]++;
+            if (around[d] != Color::NONE && length >= 4)
+            {
+                fill = around[d];
+                return true;
+            }
+        }
+        if (runs[0] + runs[1] + runs[2] == 0) // all the neighbors have the same color
+        {
+            fill = around[0];
+            return around[0] != Color::NONE;
+        }
+        fill = around[0];
+        return runs[int(Color::NONE)] == 0 && runs[int(Color::RED)] <= 1 && runs[int(Color::BLUE)] <= 1;
+    }
+
+    // are the adjacent empty positions p and q enclosed by one player, with no other
+    // empty position around them? the ring around them is then connected, so the other
+    // player can't use them and the enclosing player doesn't need them. fill gets his color
+    bool enclosed(int p, int q, Color& fill)
+    {
+        static const int rx[6] = {1, 1, 0, -1, -1, 0};
+        static const int ry[6] = {0, 1, 1, 0, -1, -1};
+        Color around[2][6];
+        if (!ring(p % size, p / size, around[0]) || !ring(q % size, q / size, around[1])) return false;
+        int dx = q % size - p % size, dy = q / size - p / size;
+        Color c = Color::NONE;
+        for (int k = 0; k < 2; k++)
+            for (int d = 0; d < 6; d++)
+            {
+                // skip the direction from one of the pair to the other
+                if (rx[d] == (k ? -dx : dx) && ry[d] == (k ? -dy : dy)) continue;
+                if (around[k][d] == Color::NONE || (c != Color::NONE && around[k][d] != c)) return false;
+                c = around[k][d];
+            }
+        fill = c;
+        return true;
+    }
+
+    // the inferior cell analysis, run on a copy of the board before an AI move: fills
+    // the dead positions and the enclosed pairs until there are none left, since every
+    // filled position can make new ones. the filled positions don't change the winner,
+    // so they are left out of the candidates and the random playouts.
+    // only the colors and the bit-planes are updated, so the copy is for playouts only
+    int fillInferior()
+    {
+        static const int dx[3] = {1, 1, 0};
+        static const int dy[3] = {0, 1, 1};
+        int filled = 0;
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (int p = 0; p < size * size; p++)
+            {
+                if (getColor(p) != Color::NONE) continue;
+                int x = p % size, y = p / size;
+                Color c;
+                if (dead(p, c))
+                {
+                    fill(x, y, c);
+                    filled++;
+                    changed = true;
+                    continue;
+                }
+                for (int d = 0; d < 3; d++)
+                {
+                    int nx = x + dx[d], ny = y + dy[d];
+                    if (nx >= size || ny >= size || getColor(pos(nx,ny)) != Color::NONE) continue;
+                    if (enclosed(p, pos(nx,ny), c))
+                    {
+                        fill(x, y, c);
+                        fill(nx, ny, c);
+                        filled += 2;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+        return filled;
+    }
+
+    // the reply that saves a bridge of the given player after the opponent's last move
+    // went into its carrier, or -1 if there is none. a bridge is a pair of the player's
+    // stones, or a stone and the master node of one of his sides, that are not connected
+    // yet and have exactly two common neighbors: here the last move and an empty position
+    int bridgeReply(Color c)
+    {
+        if (lastMove < 0 || getColor(lastMove) == c) return -1;
+        Neighbors around = neighbors(lastMove);
+        for (const uint32_t* a = around.begin(); a != around.end(); a++)
+            for (const uint32_t* b = a + 1; b != around.end(); b++)
+            {
+                int p = int(*a), q = int(*b);
+                if (getColor(p) != c || getColor(q) != c || groups.connected(p, q)) continue;
+                if (p >= size * size && q >= size * size) continue; // two master nodes
+
+                // the common neighbors of the two, the rows of the graph are sorted
+                int common = 0, other = -1;
+                Neighbors np = neighbors(p), nq = neighbors(q);
+                const uint32_t* i = np.begin();
+                const uint32_t* j = nq.begin();
+                while (i != np.end() && j != nq.end())
+                {
+                    if (*i < *j) i++;
+                    else if (*j < *i) j++;
+                    else
+                    {
+                        common++;
+                        if (int(*i) != lastMove) other = int(*i);
+                        i++;
+                        j++;
+                    }
+                }
+                if (common == 2 && other >= 0 && getColor(other) == Color::NONE) return other;
+            }
+        return -1;
+    }
+
+    // copy the per-game state of another board of the same size into this one
+    // the graph is shared and the buffers are reused, so nothing is allocated
+    void restore(const HexBoard& other)
+    {
+        HEX_COUNT(BOARD_COPIES, 1);
+        colors   = other.colors;
+        numEmpty = other.numEmpty;
+        hash     = other.hash;
+        rotatedHash = other.rotatedHash;
+        lastMove = other.lastMove;
+        bits     = other.bits;
+        groups   = other.groups;
+    }
+
+    // fill all the empty positions with a random sequence of alternating moves
+    // where toMove plays first, and return the winner of the full board
+    // moves is a scratch buffer for the shuffled colors
+    Color randomFill(Color toMove, vector<Color>& moves, Random& rng)
+    {
+        HEX_TIMER(PLAYOUT_NS);
+        HEX_COUNT(PLAYOUTS, 1);
+        // create an array with the colors to be played and shuffle it
+        Color other = (int(toMove) == int(Color::RED)) ? Color::BLUE : Color::RED;
+        moves.assign(numEmpty, other);
+        for (int j = 0, n = numEmpty; j < n; j = j + 2)
+            moves[j] = toMove;
+        rng.shuffle(moves.begin(), moves.end());
+
+        // place the blocks in the randomly created order, only the empty positions take a color
+        int n = 0;
+        for (int j = 0; j < size; j++)
+            for (int k = 0; k < size; k++)
+                if (getColor(pos(j, k)) == Color::NONE && fill(j, k, moves[n])) n++;
+
+        // the board is full so a flood fill is cheaper than keeping the groups
+        return bits.winner();
+    }
+
+    // the key of the current position in the opening book
+    // it is the same for rotated positions, whose book moves are stored in the canonical orientation
+    inline uint64_t bookKey(Color toMove) const { return canonicalHash() ^ zobrist(-1, toMove); }
+
+#ifdef HEX_STATS
+    // write one JSON line with the move and what the counters of all the threads gained
+    // during it; with games in parallel the counters include the work of the other games
+    void writeStats(Color c, const char* source, const long long before[], chrono::steady_clock::time_point start)
+    {
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        long long after[Stats::COUNTERS];
+        Stats::total(after);
+        ostringstream line;
+        line << "{\"move\": " << size * size - numEmpty << ", \"color\": \"" << (c == Color::BLUE ? "blue" : "red")
+             << "\", \"source\": \"" << source << "\", \"position\": " << lastMove << ", \"ms\": " << ms;
+        for (int i = 0; i < Stats::COUNTERS; i++)
+            line << ", \"" << Stats::name(i) << "\": " << after[i] - before[i];
+        line << "}\n";
+        cerr << line.str() << flush;
+    }
+#endif
+
+    // plays a move for the given player with the selected AI engine
+    // positions from the opening book are answered without searching
+    void playAIMove(Color AIColor)
+    {
+#ifdef HEX_STATS
+        long long before[Stats::COUNTERS];
+        Stats::total(before);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+#endif
+        const char* source = "book";
+        int p = book ? book->find(bookKey(AIColor)) : -1;
+        if (p >= 0 && rotatedHash < hash) p = rotate(p);
+        if (p >= 0 && p < size * size && getColor(p) == Color::NONE)
+            place(p % size, p / size, AIColor);
+        else if (engine == Engine::MCTS)
+        {
+            source = "mcts";
+            playTreeMove(AIColor);
+        }
+        else if (engine == Engine::AMAF)
+        {
+            source = "amaf";
+            playAmafMove(AIColor);
+        }
+        else
+        {
+            source = "flat";
+            playFlatMove(AIColor);
+        }
+#ifdef HEX_STATS
+        writeStats(AIColor, source, before, start);
+#else
+        (void)source;
+#endif
+    }
+
+    // the candidate positions of the AI, without the ones far away from the shortest connections of both players
+    // and, if the position is symmetric, without the rotated copies of the others.
+    // the reply that saves a bridge of the player to move is always a candidate and comes
+    // first, the others follow from the most important one, so a search that runs out of
+    // time has looked at the best ones
+    void candidates(vector<int>& cells, Color toMove)
+    {
+        bool half = symmetric();
+        int blue, red;
+        vector<int> importance;
+        evaluate(blue, red, importance);
+        cells.clear();
+        for (int x = 0; x < size; x++)
+            for (int y = 0; y < size; y++)
+                if (importance[pos(x,y)] >= -PRUNE && !(half && rotate(pos(x,y)) < pos(x,y)))
+                    cells.push_back(pos(x,y));
+        stable_sort(cells.begin(), cells.end(), [&](int a, int b) { return importance[a] > importance[b]; });
+        int reply = bridgeReply(toMove);
+        if (reply >= 0)
+        {
+            cells.erase(std::remove(cells.begin(), cells.end(), reply), cells.end());
+            cells.insert(cells.begin(), reply);
+        }
+    }
+
+    // plays a move for the given player using a Monte Carlo tree search, with one
+    // tree per worker thread; the trees are kept for the next move, defined after the MCTS class
+    void playTreeMove(Color AIColor);
+
+    // plays a move for the given player using a Monte Carlo AI agent with 1000 trials
+    // per position, or as many as fit in the move time if one is set. with a move time
+    // every batch checks the deadline, the positions are tried in the order of candidates
+    // and the move is chosen among the ones that got a batch before the deadline.
+    // the trials run on the bit-sliced kernel, a batch of PlayoutKernel::LANES games per
+    // task on the worker pool; each batch has its own random generator seeded from the
+    // batch number, and the results are summed in a fixed order, so the move doesn't
+    // depend on the thread count
+    void playFlatMove(Color AIColor)
+    {
+        vector<double> evaluations(size * size, -1.0); // the results of the evaluations
+        Color playerColor = (int(AIColor) == int(Color::RED)) ? Color::BLUE : Color::RED;
+        chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(moveTime);
+
+        // the candidate positions and the playouts come from the position without its inferior cells
+        HexBoard reduced(*this);
+        vector<int> cells;
+        {
+            HEX_TIMER(PREPARE_NS);
+            reduced.fillInferior();
+            reduced.candidates(cells, AIColor);
+            if (cells.empty()) candidates(cells, AIColor);
+        }
+
+        // with a move time the positions get one batch in repeated sweeps over the board
+        // until the deadline, otherwise a single sweep runs all the trials
+        int batches = moveTime > 0 ? 1 : FLAT_TRIALS / PlayoutKernel::LANES;
+
+        // every thread runs the playouts on its own kernel
+        int numThreads = pool ? pool->size() : 1;
+        vector<PlayoutKernel> kernels(numThreads, PlayoutKernel(size));
+        vector< vector<Color> > scratch(numThreads);
+        vector<int> wins(cells.size() * batches, 0), trials(cells.size() * batches, 0);
+        uint64_t seed = rng();
+        int sweep = 0;
+
+        // count the number of won games for a batch of trials of one position
+        // the first batch always runs, so there is an evaluation for at least one position
+        function<void(int, int)> batch = [&](int task, int thread)
+        {
+            if (moveTime > 0 && (sweep > 0 || task > 0) && chrono::steady_clock::now() >= deadline) return;
+            int p = cells[task / batches];
+            Random random(mixSeed(seed ^ (uint64_t(sweep) << 32) ^ uint64_t(task)));
+
+            // play the position and fill the rest of the board in all the lanes
+            scratch[thread] = reduced.colors;
+            scratch[thread][p] = AIColor;
+            kernels[thread].setPosition(scratch[thread]);
+            wins[task] += kernels[thread].play(playerColor, AIColor, random);
+            trials[task] += PlayoutKernel::LANES;
+        };
+        do
+        {
+            if (pool)
+                pool->run(int(wins.size()), batch);
+            else
+                for (int task = 0; task < int(wins.size()); task++)
+                    batch(task, 0);
+            sweep++;
+        }
+        while (moveTime > 0 && chrono::steady_clock::now() < deadline);
+
+        // merge the batches of each position into its winning rate
+        for (int c = 0; c < int(cells.size()); c++)
+        {
+            int w = 0, n = 0;
+            for (int b = 0; b < batches; b++)
+            {
+                w += wins[c * batches + b];
+                n += trials[c * batches + b];
+            }
+            if (n == 0) continue; // not reached before the deadline
+            evaluations[cells[c]] = double(w) / n;
+            playoutCount += n;
+        }
+
+        // get the move with the most wins, among the evaluated ones
+        int bestPos = cells[0];
+        double bestNum = -1.0;
+        for (int i = 0; i < size * size; i++)
+            if (evaluations[i] > bestNum)
+            {
+                bestNum = evaluations[i];
+                bestPos = i;
+            }
+
+        // play the best position
+        place(bestPos % size, bestPos / size, AIColor);
+    }
+
+    // plays a move for the given player with all-moves-as-first statistics: every playout
+    // starts with a random candidate and fills the rest of the board, and is counted for
+    // its first move (direct) and for every candidate the AI owns on the full board (AMAF).
+    // one pool of playouts, the playout count of the tree search or as many as fit in the
+    // move time, evaluates all the candidates at once. the value of a position blends both,
+    // moving from AMAF towards the direct rate as its direct playouts grow (RAVE).
+    // the counts are integers summed per thread and every task has its own random generator,
+    // so the move doesn't depend on the thread count
+    void playAmafMove(Color AIColor)
+    {
+        Color playerColor = (int(AIColor) == int(Color::RED)) ? Color::BLUE : Color::RED;
+        chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(moveTime);
+        HexBoard reduced(*this);
+        vector<int> cells;
+        {
+            HEX_TIMER(PREPARE_NS);
+            reduced.fillInferior();
+            reduced.candidates(cells, AIColor);
+            if (cells.empty()) candidates(cells, AIColor);
+        }
+
+        // the statistics of every thread: direct wins, direct playouts, AMAF wins and AMAF playouts
+        int numThreads = pool ? pool->size() : 1;
+        int n = size * size;
+        vector<HexBoard> scratch(numThreads, reduced);
+        vector< vector<Color> > moves(numThreads);
+        vector< vector<int> > stats(numThreads, vector<int>(4 * n, 0));
+        uint64_t seed = rng();
+        int sweep = 0;
+
+        // with a move time the tasks run in sweeps until the deadline
+        int tasks = moveTime > 0 ? 4 * numThreads : (playouts + AMAF_BATCH - 1) / AMAF_BATCH;
+        function<void(int, int)> batch = [&](int task, int thread)
+        {
+            if (sweep > 0 && chrono::steady_clock::now() >= deadline) return;
+            HexBoard& temp = scratch[thread];
+            int* s = stats[thread].data();
+            Random random(mixSeed(seed ^ (uint64_t(sweep) << 32) ^ uint64_t(task)));
+            for (int i = 0; i < AMAF_BATCH; i++)
+            {
+                // play a random candidate first, then fill the board
+                int p = cells[random.below(uint32_t(cells.size()))];
+                temp.restore(reduced);
+                temp.fill(p % size, p / size, AIColor);
+                int won = int(temp.randomFill(playerColor, moves[thread], random)) == int(AIColor);
+
+                // credit the first move and every candidate the AI got
+                s[p] += won;
+                s[n + p]++;
+                for (int c : cells)
+                    if (temp.getColor(c) == AIColor)
+                    {
+                        s[2 * n + c] += won;
+                        s[3 * n + c]++;
+                    }
+            }
+        };
+        do
+        {
+            if (pool)
+                pool->run(tasks, batch);
+            else
+                for (int task = 0; task < tasks; task++)
+                    batch(task, 0);
+            sweep++;
+        }
+        while (moveTime > 0 && chrono::steady_clock::now() < deadline);
+
+        // blend the statistics of each candidate and play the best one
+        int bestPos = cells[0];
+        double bestValue = -1.0;
+        for (int p : cells)
+        {
+            double direct[2] = {0.0, 0.0}, amaf[2] = {0.0, 0.0};
+            for (int t = 0; t < numThreads; t++)
+            {
+                direct[0] += stats[t][p];
+                direct[1] += stats[t][n + p];
+                amaf[0]   += stats[t][2 * n + p];
+                amaf[1]   += stats[t][3 * n + p];
+            }
+            playoutCount += (long long)direct[1];
+            double beta = sqrt(RAVE_EQUIV / (3.0 * direct[1] + RAVE_EQUIV));
+            double value = amaf[1] > 0 ? amaf[0] / amaf[1] : 0.0;
+            if (direct[1] > 0) value = (1.0 - beta) * direct[0] / direct[1] + beta * value;
+            if (value > bestValue)
+            {
+                bestValue = value;
+                bestPos = p;
+            }
+        }
+        place(bestPos % size, bestPos / size, AIColor);
+    }
+
+    // print the board
+    void print()
+    {
+        // print top down by row
+        for (int y = size - 1; y > 0; y--)
+        {
+            // print 2*(size-y) spaces at the start of each row
+            for (int x = 0; x < 2 * (size - y - 1); x++) cout << " ";
+            // print the row number
+            cout << setw(3) << left << y;
+            // print the colors for the row
+            for (int x = 0; x < size - 1; x++) cout << getColor(pos(x,y)) << " - ";
+            cout << getColor(pos(size-1,y)) << endl;
+            // print the spaces at the start of the intermediate row
+            for (int x = 0; x < 2 * (size - y) + 1; x++) cout << " ";
+            // print the intermediate row \ / \ /
+            for (int x = 0; x < size - 1; x++) cout << " \\ /";
+            cout << " \\" << endl;
+        }
+        // print the 0th row's spaces
+        for (int x = 0; x < 2 * size - 2; x++) cout << " ";
+        // print the 0th row's number
+        cout << "0  ";
+        // print the 0th row
+        for (int x = 0; x < size - 1; x++) cout << getColor(pos(x,0)) << " - ";
+        cout << getColor(pos(size-1,0)) << endl;
+        // print the spaces before the column numbers
+        for (int x = 0; x < 2 * size - 2; x++) cout << " ";
+        // print the column numbers
+        cout << "   ";
+        for (int x = 0; x < size; x++) cout << setw(4) << left << x;
+        cout << endl;
+    }
+ 
+    // the edges of a size*size board, every edge is listed once
+    static vector<Graph::Edge> boardEdges(int size)
+    {
+        vector<Graph::Edge> edges;
+        edges.reserve(3 * size * size + 4 * size);
+        auto edge = [&](int x1, int y1, int x2, int y2)
+        {
+            edges.push_back(Graph::Edge{uint32_t(y1 * size + x1), uint32_t(y2 * size + x2), 1.0});
+        };
+
+        // connect all adjacent positions
+        for (int x = 0; x < size; x++)
+            for (int y = 0; y < size; y++)
+            {
+                if (x < size-1)               edge(x, y, x+1, y);   // right
+                if (y < size-1)               edge(x, y, x, y+1);   // top
+                if (x < size-1 && y < size-1) edge(x, y, x+1, y+1); // top right
+            }
+
+        // we will add a master node on each side of the board
+        // and connect it with all the nodes in the side
+        // this way we only have to check if the master nodes are connected
+        // to determine if a player has won
+        uint32_t master = uint32_t(size * size);
+        for (int i = 0; i < size; i++)
+        {
+            edges.push_back(Graph::Edge{uint32_t(i * size), master, 1.0});                  // left side, left master node
+            edges.push_back(Graph::Edge{uint32_t(i * size + size - 1), master + 1, 1.0});   // right side, right master node
+            edges.push_back(Graph::Edge{uint32_t((size - 1) * size + i), master + 2, 1.0}); // top side, top master node
+            edges.push_back(Graph::Edge{uint32_t(i), master + 3, 1.0});                     // bottom side, bottom master node
+        }
+        return edges;
+    }
+
+    public:
+    // initiate a size*size graph to represent the board
+    // we will use four additional nodes to help determine if a player has won
+    HexBoard(int size) : ColoredGraph(size * size + 4, boardEdges(size)), size(size), numEmpty(size * size),
+        hash(mixSeed(uint64_t(size) << 40)), rotatedHash(hash), lastMove(-1), bits(size), groups(size * size + 4),
+        engine(Engine::MCTS), playouts(50000), moveTime(0), hashSize(64), playoutCount(0), pondering(false),
+        rng(uint64_t(time(NULL)))
+    {
+        // left and right sides are blue
+        setColor(size * size,     Color::BLUE); // left master node
+        setColor(size * size + 1, Color::BLUE); // right master node 
+
+        // top and bottom sides are red
+        setColor(size * size + 2, Color::RED);  // top master node
+        setColor(size * size + 3, Color::RED);  // bottom master node
+    }
+    
+    // a copy constructor to duplicate an existing hex board
+    HexBoard(const HexBoard& other) : 
+        ColoredGraph(other), size(other.size), numEmpty(other.numEmpty), hash(other.hash),
+        rotatedHash(other.rotatedHash), lastMove(other.lastMove), bits(other.bits), groups(other.groups), pool(other.pool),
+        engine(other.engine), playouts(other.playouts), moveTime(other.moveTime),
+        hashSize(other.hashSize), book(other.book), playoutCount(0), pondering(false), rng(other.rng)
+    {
+        HEX_COUNT(BOARD_COPIES, 1);
+    }
+
+    // take the AI settings of a board that may have another size, sharing its worker pool and book
+    void copySettings(const HexBoard& other)
+    {
+        pool = other.pool;
+        engine = other.engine;
+        playouts = other.playouts;
+        moveTime = other.moveTime;
+        hashSize = other.hashSize;
+        book = other.book;
+        rng = other.rng;
+    }
+
+    // a pondering search must not outlive the board it reads
+    ~HexBoard() { stopPondering(); }
+
+    // run the AI on the given number of threads, 1 or less runs it on the calling thread
+    void setThreads(int numThreads)
+    {
+        pool = numThreads > 1 ? make_shared<WorkerPool>(numThreads) : nullptr;
+    }
+
+    // select the AI engine and the playouts per move of the tree search and the AMAF engine
+    void setEngine(Engine e, int numPlayouts)
+    {
+        engine = e;
+        playouts = numPlayouts;
+    }
+
+    // give every AI move a time budget in milliseconds instead of a fixed number of
+    // playouts, the search stops at the first playout batch after the deadline; 0 turns it off
+    void setMoveTime(int milliseconds) { moveTime = milliseconds; }
+
+    // empty the board for a new game, the settings and the search memory are kept
+    // defined after the MCTS class
+    void clear();
+
+    // forget what the tree search learned, the trees and the transposition table are
+    // emptied but keep their memory; defined after the MCTS class
+    void forgetSearch();
+
+    // a static evaluation of the position by shortest paths, without any playouts.
+    // blue and red get the number of empty hexes each player still needs to connect
+    // his sides, more than size * size if he can't. importance gets a score for every
+    // empty position: 0 if it lies on a shortest connection of either player, and one
+    // less for every extra hex the best connection through it needs; occupied positions get INT_MIN
+    void evaluate(int& blue, int& red, vector<int>& importance)
+    {
+        // scratch buffers, reused by every evaluation on this thread
+        static thread_local vector<int> from, to, layer, next;
+        importance.assign(size * size, INT_MIN);
+        for (int p = 0; p < size * size; p++)
+            if (getColor(p) == Color::NONE) importance[p] = -(size * size);
+
+        for (int side = 0; side < 2; side++)
+        {
+            Color c = side ? Color::RED : Color::BLUE;
+            int master = side ? size * size + 2 : size * size;
+            distances(master, c, from, layer, next);
+            distances(master + 1, c, to, layer, next);
+            int total = from[master + 1];
+            (side ? red : blue) = total;
+            if (total > size * size) continue;
+
+            // the best connection through an empty hex counts the hex in both distances
+            for (int p = 0; p < size * size; p++)
+                if (getColor(p) == Color::NONE)
+                    importance[p] = max(importance[p], total - (from[p] + to[p] - 1));
+        }
+    }
+
+    // the playouts run by the AI on this board so far, not counting pondering
+    inline long long getPlayoutCount() const { return playoutCount; }
+
+    // seed the AI's random choices, the same seed and settings repeat the same moves
+    // as long as the searches are not limited by time. the tree search repeats them on
+    // one thread only: every extra thread adds a tree that votes on the move and shares
+    // the transposition table, so the moves depend on the thread count and the timing
+    void setSeed(uint64_t seed) { rng.seed(seed); }
+
+    // let the tree search think while the human player enters a move
+    void setPondering(bool on) { pondering = on; }
+
+    // the memory cap of the transposition table in megabytes, 0 to search without one
+    // the trees and the table are created again by prepareSearch or the next AI move
+    void setHashSize(int megabytes)
+    {
+        stopPondering();
+        hashSize = megabytes;
+        table.reset();
+        trees.clear();
+    }
+
+    // allocate the trees and the transposition table of the tree search before the
+    // game starts, so zeroing a large table doesn't use up the first move's time
+    void prepareSearch()
+    {
+        if (engine == Engine::MCTS) makeTrees();
+    }
+
+    // map an opening book file, returns false and describes the problem in error if it can't be used
+    bool setBook(const string& filename, string& error)
+    {
+        shared_ptr<OpeningBook> b = make_shared<OpeningBook>();
+        if (!b->load(filename, error)) return false;
+        book = b;
+        return true;
+    }
+
+    // search the openings of every board size from minSize to maxSize with the given
+    // number of playouts per position and write them to an opening book file.
+    // the book covers the first depth plies of a game: every move of the opponent is
+    // answered and the AI's own moves follow the book. returns false with the problem
+    // in error if the file can't be written. defined after the MCTS class
+    static bool makeBook(const string& filename, int minSize, int maxSize, int depth,
+                         int playouts, int numThreads, string& error);
+
+    // play a game of hex with two human players
+    void multiPlayer()
+    {
+        Color nextPlayer = Color::BLUE; // Blue plays first
+        Color winner     = Color::NONE; // the winner's color
+
+        // loop until we have a winner
+        while (int(winner) == int(Color::NONE))
+        {
+            // print the board and ask for the next move
+            print();
+            if (int(nextPlayer) == int(Color::BLUE))
+                cout << "Blue player's turn! You must make an \"X\" path from left to right.\n";
+            else
+                cout << "Red player's turn! You must make an \"O\" path from top to bottom.\n";
+
+            int x, y;
+            cout << "Enter a row number    : "; cin >> y;
+            cout << "Enter a column number : "; cin >> x;
+
+            // check if the move was valid, check if we have a winner and swap the next player
+            if (place(x,y,nextPlayer))
+            {
+                winner = getWinner();
+                nextPlayer = (int(nextPlayer) == int(Color::BLUE)) ? Color::RED : Color::BLUE;
+            }
+            else
+                cout << "That move was illegal!" << endl;
+        }
+
+        // print the final board and the final message (there can be no draw in this game)
+        print();
+        if (int(winner) == int(Color::BLUE))
+            cout << "Blue player wins! Congratulations!" << endl;
+        else
+            cout << "Red player wins! Congratulations!" << endl;
+    }
+
+    // play a game of hex versus an AI opponent
+    void singlePlayer(bool playersTurn)
+    {
+        prepareSearch();
+        Color nextPlayer = Color::BLUE; // Blue plays first
+        Color winner     = Color::NONE; // the winner's color
+
+        // loop until we have a winner
+        while (int(winner) == int(Color::NONE))
+        {
+            print();
+            if (playersTurn) // player's move
+            {
+                // ask the player for his move, the AI may think in the meantime
+                int x, y;
+                startPondering(nextPlayer);
+                cout << "It's your turn! Try to create an \"" << nextPlayer
+                     << "\" path from "
+                     << ((int(nextPlayer) == int(Color::BLUE)) ? "left to right.\n" : "top to bottom.\n");
+                cout << "Enter the row number    : "; cin >> y;
+                cout << "Enter the column number : "; cin >> x;
+                stopPondering();
+
+                // do the move and go on to the next player if it was valid
+                if (place(x,y,nextPlayer))
+                {
+                    winner = getWinner();
+                    nextPlayer = (int(nextPlayer) == int(Color::BLUE)) ? Color::RED : Color::BLUE;
+                    playersTurn = false;
+                }
+                else
+                    cout << "That move was illegal." << endl;
+            }
+            else // play an AI move and go on to the next player
+            {
+                cout << "Thinking... " << endl;
+                playAIMove(nextPlayer);
+                winner = getWinner();
+                nextPlayer = (int(nextPlayer) == int(Color::BLUE)) ? Color::RED : Color::BLUE;
+                playersTurn = true;
+                cout << "Done! " << endl;
+            }
+        }
+
+        // print the final board and the final message (there can be no draw in this game)
+        print();
+        if (playersTurn)
+            cout << "You lost the game. Better luck next time." << endl;
+        else
+            cout << "You win! Congratulations!" << endl;
+    }
+
+    // plays games of the AI against itself without any prompts and reports the
+    // playouts per second, the time per move and the wins of each color.
+    // the games are played on a copy of this board, so they use its worker pool,
+    // book and settings; the seed makes a series of games with fixed playouts repeatable,
+    // with the tree search on one thread
+    void selfPlay(int games, uint64_t seed)
+    {
+        vector<double> moveTimes; // milliseconds of every AI move
+        double searchTime = 0.0;
+        int blueWins = 0;
+
+        // one board is cleared between the games, so the search memory stays warm
+        HexBoard game(*this);
+        game.setSeed(seed);
+        game.prepareSearch();
+        for (int g = 0; g < games; g++)
+        {
+            game.clear();
+            Color next = Color::BLUE;
+            while (game.getWinner() == Color::NONE)
+            {
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                game.playAIMove(next);
+                double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                moveTimes.push_back(ms);
+                searchTime += ms;
+                next = (next == Color::BLUE) ? Color::RED : Color::BLUE;
+            }
+            if (game.getWinner() == Color::BLUE) blueWins++;
+            cout << "game " << g + 1 << ": " << (game.getWinner() == Color::BLUE ? "blue" : "red")
+                 << " wins" << endl;
+        }
+
+        // summarize, the percentiles use the nearest rank
+        long long playouts = game.getPlayoutCount();
+        sort(moveTimes.begin(), moveTimes.end());
+        double mean = 0.0;
+        for (double t : moveTimes) mean += t;
+        mean /= max<size_t>(moveTimes.size(), 1);
+        auto percentile = [&](double q)
+        {
+            if (moveTimes.empty()) return 0.0;
+            size_t rank = size_t(ceil(q * moveTimes.size()));
+            return moveTimes[min(max<size_t>(rank, 1), moveTimes.size()) - 1];
+        };
+        cout << fixed << setprecision(1);
+        cout << "games     : " << games << " (seed " << seed << ")" << endl;
+        cout << "blue wins : " << blueWins << " (" << 100.0 * blueWins / max(games, 1) << "%)" << endl;
+        cout << "red wins  : " << games - blueWins << " (" << 100.0 * (games - blueWins) / max(games, 1) << "%)" << endl;
+        cout << "moves     : " << moveTimes.size() << endl;
+        cout << "playouts  : " << playouts << " (" << (searchTime > 0 ? playouts / searchTime * 1000.0 : 0.0)
+             << " per second)" << endl;
+        cout << "ms/move   : mean " << mean << ", p50 " << percentile(0.5) << ", p99 " << percentile(0.99) << endl;
+    }
+
+    // plays games of this board's AI against the AI of another board of the same size,
+    // one game per worker thread on all the given threads, and prints a JSON summary:
+    // the wins of each side with a 95% Wilson interval, the Elo difference it implies
+    // and the time per move of each side. the sides alternate colors, this one is blue
+    // in the even games, and every game is seeded from its number and starts with
+    // empty search memory, so with fixed playouts the results don't depend on the
+    // number of threads. every worker keeps its own pair of boards between games and
+    // the searches run on the worker's thread; the tables of the sides are capped at
+    // MATCH_HASH megabytes, so a match on many threads doesn't take many times the hash memory
+    void match(int games, const HexBoard& opponent, uint64_t seed, int numThreads)
+    {
+        numThreads = max(min(numThreads, games), 1);
+        vector<HexBoard> first(numThreads, *this), second(numThreads, opponent);
+        for (int t = 0; t < numThreads; t++)
+            for (HexBoard* b : {&first[t], &second[t]})
+            {
+                b->setThreads(1);
+                b->setPondering(false);
+                b->setHashSize(min(b->hashSize, MATCH_HASH));
+                b->prepareSearch();
+            }
+
+        // the results of every game by its number, so the order doesn't depend on the threads
+        vector<char> firstWon(games, 0), blueWon(games, 0);
+        vector< vector<double> > firstTimes(games), secondTimes(games);
+        function<void(int, int)> play = [&](int g, int thread)
+        {
+            // the boards are reused, but every game starts a new search memory
+            // so it doesn't depend on the games the worker played before
+            HexBoard& a = first[thread];
+            HexBoard& b = second[thread];
+            a.clear();
+            b.clear();
+            a.forgetSearch();
+            b.forgetSearch();
+            a.setSeed(mixSeed(seed ^ (uint64_t(g) << 1)));
+            b.setSeed(mixSeed(seed ^ (uint64_t(g) << 1 | 1)));
+            bool firstBlue = g % 2 == 0;
+            Color next = Color::BLUE;
+            while (a.getWinner() == Color::NONE)
+            {
+                bool firstMoves = (next == Color::BLUE) == firstBlue;
+                HexBoard& mover = firstMoves ? a : b;
+                HexBoard& other = firstMoves ? b : a;
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                mover.playAIMove(next);
+                double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                (firstMoves ? firstTimes : secondTimes)[g].push_back(ms);
+                other.place(mover.lastMove % size, mover.lastMove / size, next);
+                next = (next == Color::BLUE) ? Color::RED : Color::BLUE;
+            }
+            blueWon[g] = a.getWinner() == Color::BLUE;
+            firstWon[g] = blueWon[g] == firstBlue;
+        };
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        WorkerPool workers(numThreads);
+        workers.run(games, play);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        // the score of this side with its Wilson interval, and the Elo difference of each
+        int wins = 0, blueWins = 0;
+        for (int g = 0; g < games; g++)
+        {
+            wins += firstWon[g];
+            blueWins += blueWon[g];
+        }
+        double n = max(games, 1), p = wins / n, z = 1.96;
+        double center = (p + z * z / (2 * n)) / (1 + z * z / n);
+        double half = z * sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / (1 + z * z / n);
+        auto elo = [](double score) { return -400.0 * log10(1.0 / score - 1.0); };
+        auto number = [](double x) { return isfinite(x) ? to_string(x) : string("null"); };
+
+        // the time per move of one side, the percentiles use the nearest rank
+        auto timing = [&](const vector< vector<double> >& times, long long playouts)
+        {
+            vector<double> all;
+            for (const vector<double>& t : times) all.insert(all.end(), t.begin(), t.end());
+            sort(all.begin(), all.end());
+            double sum = 0.0;
+            for (double t : all) sum += t;
+            auto percentile = [&](double q)
+            {
+                if (all.empty()) return 0.0;
+                size_t rank = size_t(ceil(q * all.size()));
+                return all[min(max<size_t>(rank, 1), all.size()) - 1];
+            };
+            return "{\"moves\": " + to_string(all.size()) + ", \"playouts\": " + to_string(playouts)
+                 + ", \"ms_mean\": " + number(sum / max<size_t>(all.size(), 1))
+                 + ", \"ms_p50\": " + number(percentile(0.5)) + ", \"ms_p90\": " + number(percentile(0.9))
+                 + ", \"ms_max\": " + number(all.empty() ? 0.0 : all.back()) + "}";
+        };
+        auto side = [&](const HexBoard& b, const vector<HexBoard>& boards, const vector< vector<double> >& times)
+        {
+            long long playouts = 0;
+            for (const HexBoard& w : boards) playouts += w.getPlayoutCount();
+            // the flat engine ignores the playouts and runs a fixed number of trials per position
+            bool flat = b.engine == Engine::FLAT;
+            const char* name = flat ? "flat" : b.engine == Engine::AMAF ? "amaf" : "mcts";
+            return "{\"engine\": \"" + string(name) + (flat ? "\", \"trials\": " : "\", \"playouts\": ")
+                 + to_string(flat ? FLAT_TRIALS : b.playouts)
+                 + ", \"time_ms\": " + to_string(b.moveTime) + ", \"hash_mb\": " + to_string(min(b.hashSize, MATCH_HASH))
+                 + ", \"timing\": " + timing(times, playouts) + "}";
+        };
+
+        cout << "{\"size\": " << size << ", \"games\": " << games << ", \"seed\": " << seed
+             << ", \"threads\": " << numThreads << ", \"seconds\": " << number(seconds) << ",\n"
+             << " \"first\": " << side(*this, first, firstTimes) << ",\n"
+             << " \"second\": " << side(opponent, second, secondTimes) << ",\n"
+             << " \"first_wins\": " << wins << ", \"second_wins\": " << games - wins
+             << ", \"blue_wins\": " << blueWins << ",\n"
+             << " \"first_score\": " << number(p) << ", \"first_score_ci95\": [" << number(center - half)
+             << ", " << number(center + half) << "],\n"
+             << " \"elo\": " << number(elo(p)) << ", \"elo_ci95\": [" << number(elo(center - half))
+             << ", " << number(elo(center + half)) << "]}" << endl;
+    }
+};
+
+// a fixed-size table of playout statistics indexed by the zobrist hash of a position
+// it lets the tree search share what it learned about a position between all the
+// move orders that lead to it. the entries are grouped in buckets of one cache line,
+// so a lookup touches a single line; a full bucket replaces its least visited entry,
+// which keeps the well explored positions and lets the rarely seen ones go.
+// the trees of a parallel search share one table without locks: the fields are
+// relaxed atomics, so a race can lose a playout or mix two positions in an entry,
+// which only blurs the statistics a little
+class TranspositionTable
+{
+    public:
+    struct Entry
+    {
+        uint32_t visits; // the playouts through the position
+        uint32_t wins;   // the playouts won by the player who made the last move
+    };
+
+    private:
+    struct Slot
+    {
+        atomic<uint32_t> check;  // the high half of the hash, to tell positions in a bucket apart
+        atomic<uint32_t> visits; // 0 for a free slot
+        atomic<uint32_t> wins;
+        uint32_t padding;
+    };
+
+    struct alignas(64) Bucket
+    {
+        Slot slots[4];
+    };
+
+    unique_ptr<Bucket[]> buckets; // a power of two number of buckets, null for no table
+    uint64_t mask;                // selects a bucket from the low bits of a hash
+
+    static inline uint32_t get(const atomic<uint32_t>& a) { return a.load(memory_order_relaxed); }
+    static inline void put(atomic<uint32_t>& a, uint32_t v) { a.store(v, memory_order_relaxed); }
+
+    public:
+    // a table that uses at most the given number of megabytes, rounded down to a power of two
+    TranspositionTable(int megabytes) : mask(0)
+    {
+        size_t bytes = size_t(max(megabytes, 0)) << 20, n = 1;
+        while (2 * n * sizeof(Bucket) <= bytes) n *= 2;
+        if (n * sizeof(Bucket) > bytes) return;
+        buckets.reset(new Bucket[n]);
+        mask = n - 1;
+        clear();
+    }
+
+    // is there room for any entries?
+    inline bool enabled() const { return bool(buckets); }
+
+    // forget all the positions, the memory is kept
+    void clear()
+    {
+        if (buckets) memset(static_cast<void*>(buckets.get()), 0, (mask + 1) * sizeof(Bucket));
+    }
+
+    // get the statistics of a position, returns false if it is not in the table
+    bool find(uint64_t hash, Entry& e) const
+    {
+        if (!buckets) return false;
+        const Bucket& b = buckets[hash & mask];
+        for (const Slot& slot : b.slots)
+        {
+            e.visits = get(slot.visits);
+            e.wins = get(slot.wins);
+            if (e.visits && get(slot.check) == uint32_t(hash >> 32)) return e.wins <= e.visits;
+        }
+        return false;
+    }
+
+    // add the result of a playout to the statistics of a position
+    // a new position takes a free slot or the least visited one of its bucket
+    void update(uint64_t hash, bool won)
+    {
+        if (!buckets) return;
+        Bucket& b = buckets[hash & mask];
+        Slot* slot = &b.slots[0];
+        for (Slot& e : b.slots)
+        {
+            if (get(e.visits) && get(e.check) == uint32_t(hash >> 32))
+            {
+                slot = &e;
+                break;
+            }
+            if (get(e.visits) < get(slot->visits)) slot = &e;
+        }
+        if (!get(slot->visits) || get(slot->check) != uint32_t(hash >> 32))
+        {
+            put(slot->check, uint32_t(hash >> 32));
+            put(slot->visits, 0);
+            put(slot->wins, 0);
+        }
+        put(slot->visits, get(slot->visits) + 1);
+        if (won) put(slot->wins, get(slot->wins) + 1);
+    }
+};
+
+// a Monte Carlo tree search player using the UCT selection rule
+// every playout walks down the tree picking the child with the best upper
+// confidence bound, expands the leaf once it has been visited often enough,
+// finishes the game with a random fill and updates the statistics on the path
+class MCTS
+{
+    private:
+    struct Node
+    {
+        int move;        // the position played to reach this node, -1 for the root
+        int children;    // the index of the first child, -1 if not expanded
+        int numChildren; // the children are stored next to each other
+        int visits;      // the playouts through this node
+        int wins;        // the playouts won by the player who made the move
+    };
+
+    static const int PRIOR = 32;   // the most playouts a new node takes over from the table
+
+    static const int EXPAND = 4;   // the visits a leaf needs before it gets children
+    static const int BATCH  = 64;  // the playouts between two checks of the deadline
+    const double exploration;      // the weight of the exploration term of UCT
+    const int maxNodes;            // no more leaves are expanded beyond this size
+    vector<Node> tree;             // all the nodes, the root is the first one
+    vector<Node> spare;            // the buffer the kept subtree is copied to when the root moves
+    Color rootToMove;              // the player to move at the root
+    int rootEmpty;                 // the empty positions at the root, to detect a stale tree
+    atomic<bool> stopping;         // set from another thread to end a running search
+    int searched;                  // the playouts run by the last search
+    shared_ptr<TranspositionTable> table; // the statistics shared between transpositions and trees, may be null
+    vector<int> path;              // the nodes visited by the current playout
+    vector<uint64_t> hashes;       // the hashes of the positions of the nodes on the path
+    vector<Color> moves;           // scratch buffer for the random fills
+    vector<int> importance;        // scratch buffer for the evaluation of the expanded position
+    Random rng;
+
+    // the child of a node with the highest upper confidence bound
+    // unvisited children are always tried first
+    int select(int node)
+    {
+        const Node& n = tree[node];
+        double logVisits = log(double(n.visits + 1)); // children may have playouts from the table
+        int best = n.children;
+        double bestValue = -1.0;
+        for (int c = n.children; c < n.children + n.numChildren; c++)
+        {
+            const Node& child = tree[c];
+            if (child.visits == 0) return c;
+            double value = double(child.wins) / child.visits
+                         + exploration * sqrt(logVisits / child.visits);
+            if (value > bestValue)
+            {
+                bestValue = value;
+                best = c;
+            }
+        }
+        return best;
+    }
+
+    // the key of a position together with the player who made the last move
+    // it is given the canonical hash, so rotated positions share their statistics
+    static inline uint64_t key(uint64_t hash, Color mover) { return hash ^ HexBoard::zobrist(-1, mover); }
+
+    // add a child for every empty position of the board that isn't dead, or for all of them
+    // if they all are, and on a symmetric board only one of two rotated positions.
+    // the ones on the shortest connections of the players come first and in
+    // random order among equals, so they are the first to be tried, after the
+    // reply that saves a bridge the opponent's last move intruded into.
+    // a child whose position is already in the table starts with its statistics,
+    // scaled down to at most PRIOR playouts so they can't outweigh the tree's own
+    void expand(int node, HexBoard& board, Color toMove)
+    {
+        HEX_TIMER(EXPAND_NS);
+        int first = int(tree.size());
+        bool half = board.symmetric();
+        Color fill;
+        for (int pass = 0; pass < 2 && int(tree.size()) == first; pass++)
+            for (int p = 0; p < board.size * board.size; p++)
+            {
+                if (board.getColor(p) != Color::NONE || (pass == 0 && board.dead(p, fill))) continue;
+                if (half && board.rotate(p) < p) continue;
+                Node child{p, -1, 0, 0, 0};
+                uint64_t childHash = min(board.hash ^ HexBoard::zobrist(p, toMove),
+                                         board.rotatedHash ^ HexBoard::zobrist(board.rotate(p), toMove));
+                TranspositionTable::Entry e;
+                if (table && table->find(key(childHash, toMove), e))
+                {
+                    child.visits = int(min<uint32_t>(e.visits, PRIOR));
+                    child.wins = int(uint64_t(e.wins) * child.visits / e.visits);
+                }
+                tree.push_back(child);
+            }
+        rng.shuffle(tree.begin() + first, tree.end());
+        int blue, red;
+        board.evaluate(blue, red, importance);
+        stable_sort(tree.begin() + first, tree.end(),
+                    [&](const Node& a, const Node& b) { return importance[a.move] > importance[b.move]; });
+
+        // the reply that saves an intruded bridge is tried first of all
+        int reply = board.bridgeReply(toMove);
+        for (int c = first; c < int(tree.size()); c++)
+            if (tree[c].move == reply)
+            {
+                rotate(tree.begin() + first, tree.begin() + c, tree.begin() + c + 1);
+                break;
+            }
+        tree[node].children = first;
+        tree[node].numChildren = int(tree.size()) - first;
+    }
+
+    public:
+    static const int MAX_NODES = 1 << 22; // the default size cap of a tree, split between the trees of a parallel search
+
+    // a search that keeps its statistics in the given table, or in its tree only if there is none
+    MCTS(shared_ptr<TranspositionTable> table = nullptr, double exploration = 0.4, int maxNodes = MAX_NODES) :
+        exploration(exploration), maxNodes(maxNodes), rootToMove(Color::NONE), rootEmpty(-1), stopping(false),
+        searched(0), table(table) {}
+
+    // the playouts run by the last search
+    inline int playoutsDone() const { return searched; }
+
+    // ask a search running on another thread to return at its next deadline check
+    // the request stays set until clearStop, so it can't be missed by a search about to start
+    inline void stop() { stopping = true; }
+    inline void clearStop() { stopping = false; }
+
+    // the winning rate of a move of the root in the last search, -1 if it was never tried
+    double rootValue(int move) const
+    {
+        if (tree.empty() || tree[0].children < 0) return -1.0;
+        for (int c = tree[0].children; c < tree[0].children + tree[0].numChildren; c++)
+            if (tree[c].move == move && tree[c].visits > 0)
+                return double(tree[c].wins) / tree[c].visits;
+        return -1.0;
+    }
+
+    // add the visits of the root's children in the last search to the entries of their moves
+    void addRootVisits(vector<long long>& visits) const
+    {
+        if (tree.empty() || tree[0].children < 0) return;
+        for (int c = tree[0].children; c < tree[0].children + tree[0].numChildren; c++)
+            visits[tree[c].move] += tree[c].visits;
+    }
+
+    // forget the tree, the transposition table is kept
+    inline void reset() { tree.clear(); }
+
+    // make the child reached by the given move the new root, keeping its statistics
+    // the rest of the tree is dropped; if the move was never expanded the tree starts over
+    void advance(int move)
+    {
+        int child = -1;
+        if (!tree.empty() && tree[0].children >= 0)
+            for (int c = tree[0].children; c < tree[0].children + tree[0].numChildren; c++)
+                if (tree[c].move == move) child = c;
+        if (child < 0)
+        {
+            tree.clear();
+            return;
+        }
+
+        // copy the subtree breadth first, every block of children stays contiguous
+        spare.assign(1, tree[child]);
+        for (int i = 0; i < int(spare.size()); i++)
+        {
+            int first = spare[i].children;
+            if (first < 0) continue;
+            spare[i].children = int(spare.size());
+            spare.insert(spare.end(), tree.begin() + first, tree.begin() + first + spare[i].numChildren);
+        }
+        spare[0].move = -1;
+        tree.swap(spare);
+        spare.clear();
+        rootToMove = (rootToMove == Color::RED) ? Color::BLUE : Color::RED;
+        rootEmpty--;
+    }
 
-        // top and bottom sides are red
-        setColor(size * size + 2, Color::RED);  // top master node
-        setColor(size * size + 3, Color::RED);  // bottom master node
+    // search the position of the board where toMove plays next until the given
+    // number of playouts is done or the deadline has passed, whichever comes first,
+    // and return the position of the most visited move.
+    // the deadline and stop requests are checked every BATCH playouts and at least one batch always runs.
+    // the statistics of a tree that was advanced to this position are kept
+    int search(const HexBoard& board, Color toMove, int playouts,
+               chrono::steady_clock::time_point deadline, uint64_t seed)
+    {
+        rng.seed(seed);
+        if (tree.empty() || rootToMove != toMove || rootEmpty != board.numEmpty)
+            tree.assign(1, Node{-1, -1, 0, 0, 0});
+        rootToMove = toMove;
+        rootEmpty = board.numEmpty;
+        HexBoard temp(board);
 
-        // connect the left side with the left master node
-        for (int y = 0; y < size; y++)
-            add(pos(0,y), size * size);
+        int i = 0;
+        for (; i < playouts; i++)
+        {
+            if (i > 0 && i % BATCH == 0 && (stopping || chrono::steady_clock::now() >= deadline)) break;
 
-        // connect the right side with the right master node
-        for (int y = 0; y < size; y++)
-            add(pos(size-1,y), size * size + 1);
+            temp.restore(board);
+            path.assign(1, 0);
+            hashes.assign(1, 0);
+            int node = 0;
+            Color c = toMove;
+            Color winner = Color::NONE;
 
-        // connect the top side with the top master node
-        for (int x = 0; x < size; x++)
-            add(pos(x,size-1), size * size + 2);
+            // walk down the tree until a leaf or the end of the game
+            while (true)
+            {
+                if (tree[node].children < 0)
+                {
+                    // expand leaves that have been visited often enough while there is room, then try one child
+                    if ((tree[node].visits < EXPAND || int(tree.size()) + temp.numEmpty > maxNodes) && node != 0) break;
+                    expand(node, temp, c);
+                    if (tree[node].numChildren == 0) break;
+                }
+                node = select(node);
+                HEX_COUNT(NODES, 1);
+                temp.place(tree[node].move % temp.size, tree[node].move / temp.size, c);
+                path.push_back(node);
+                hashes.push_back(key(temp.canonicalHash(), c));
+                c = (c == Color::RED) ? Color::BLUE : Color::RED;
+                winner = temp.getWinner();
+                if (winner != Color::NONE) break;
+            }
 
-        // connect the bottom side with the bottom master node
-        for (int x = 0; x < size; x++)
-            add(pos(x,0), size * size + 3);
+            // finish the game randomly
+            if (winner == Color::NONE)
+                winner = temp.randomFill(c, moves, rng);
+
+            // update the statistics, the root's children were played by toMove
+            Color mover = toMove;
+            tree[0].visits++;
+            for (int k = 1; k < int(path.size()); k++)
+            {
+                Node& n = tree[path[k]];
+                n.visits++;
+                if (winner == mover) n.wins++;
+                if (table) table->update(hashes[k], winner == mover);
+                mover = (mover == Color::RED) ? Color::BLUE : Color::RED;
+            }
+        }
+
+        searched = i;
+
+        // the most visited move is the most reliable one
+        const Node& root = tree[0];
+        int best = root.children;
+        for (int c = root.children; c < root.children + root.numChildren; c++)
+            if (tree[c].visits > tree[best].visits) best = c;
+        return tree[best].move;
     }
-    
-    // a copy constructor to duplicate an existing hex board
-    HexBoard(const HexBoard& other) : 
-        ColoredGraph(other), size(other.size), numEmpty(other.numEmpty) {}
+};
 
-    // play a game of hex with two human players
-    void multiPlayer()
+// create a search tree for every thread of the pool unless they exist
+inline void HexBoard::makeTrees()
+{
+    int n = pool ? pool->size() : 1;
+    if (int(trees.size()) == n) return;
+    if (!table && hashSize > 0) table = make_shared<TranspositionTable>(hashSize);
+    trees.clear();
+    for (int i = 0; i < n; i++)
+        trees.push_back(make_shared<MCTS>(table, 0.4, MCTS::MAX_NODES / n));
+}
+
+// search the position on all the trees in parallel, a root parallel search: every tree
+// runs all the playouts with a seed of its own, and their root visits are added up
+inline int HexBoard::searchTrees(Color toMove, int numPlayouts, chrono::steady_clock::time_point deadline)
+{
+    makeTrees();
+    int n = int(trees.size());
+    uint64_t seed = rng();
+    function<void(int, int)> searchTree = [&](int i, int)
     {
-        Color nextPlayer = Color::BLUE; // Blue plays first
-        Color winner     = Color::NONE; // the winner's color
+        trees[i]->search(*this, toMove, numPlayouts, deadline, mixSeed(seed ^ uint64_t(i)));
+    };
+    if (pool) pool->run(n, searchTree);
+    else      searchTree(0, 0);
 
-        // loop until we have a winner
-        while (int(winner) == int(Color::NONE))
-        {
-            // print the board and ask for the next move
-            print();
-            if (int(nextPlayer) == int(Color::BLUE))
-                cout << "Blue player's turn! You must make an \"X\" path from left to right.\n";
-            else
-                cout << "Red player's turn! You must make an \"O\" path from top to bottom.\n";
+    // the most visited move is the most reliable one, the first one on ties
+    vector<long long> visits(size * size, 0);
+    for (const shared_ptr<MCTS>& t : trees) t->addRootVisits(visits);
+    int best = -1;
+    for (int p = 0; p < size * size; p++)
+        if (getColor(p) == Color::NONE && (best < 0 || visits[p] > visits[best])) best = p;
+    return best;
+}
 
-            int x, y;
-            cout << "Enter a row number    : "; cin >> y;
-            cout << "Enter a column number : "; cin >> x;
+// plays a move for the given player using a Monte Carlo tree search
+inline void HexBoard::playTreeMove(Color AIColor)
+{
+    // the clock starts once the search memory exists, allocating it isn't thinking
+    makeTrees();
+    chrono::steady_clock::time_point deadline = moveTime > 0
+        ? chrono::steady_clock::now() + chrono::milliseconds(moveTime)
+        : chrono::steady_clock::time_point::max();
+    int best = searchTrees(AIColor, moveTime > 0 ? INT_MAX : playouts, deadline);
+    for (const shared_ptr<MCTS>& t : trees) playoutCount += t->playoutsDone();
+    place(best % size, best / size, AIColor);
+}
 
-            // check if the move was valid, check if we have a winner and swap the next player
-            if (place(x,y,nextPlayer))
+// search the openings of every board size and write them to an opening book file
+// the positions of each ply are searched in parallel, one tree search per position
+inline bool HexBoard::makeBook(const string& filename, int minSize, int maxSize, int depth,
+                               int playouts, int numThreads, string& error)
+{
+    vector<OpeningBook::Entry> entries;
+    WorkerPool workers(max(numThreads, 1));
+
+    for (int size = minSize; size <= maxSize; size++)
+    {
+        // the positions the AI has to answer at the current ply, starting with the
+        // empty board for blue and every opening move of blue for red
+        // positions that are rotations of each other are searched once
+        HexBoard empty(size);
+        vector<HexBoard> frontier(1, empty);
+        vector<Color> toMove(1, Color::BLUE);
+        vector<int> plies(1, 0);
+        unordered_set<uint64_t> seen;
+        if (depth > 1)
+            for (int p = 0; p < size * size; p++)
             {
-                winner = getWinner();
-                nextPlayer = (int(nextPlayer) == int(Color::BLUE)) ? Color::RED : Color::BLUE;
+                if (empty.rotate(p) < p) continue;
+                frontier.push_back(empty);
+                frontier.back().place(p % size, p / size, Color::BLUE);
+                toMove.push_back(Color::RED);
+                plies.push_back(1);
             }
-            else
-                cout << "That move was illegal!" << endl;
+
+        while (!frontier.empty())
+        {
+            // search every position of this ply
+            vector<int> best(frontier.size());
+            vector<float> value(frontier.size());
+            function<void(int, int)> searchPosition = [&](int i, int)
+            {
+                MCTS search;
+                best[i] = search.search(frontier[i], toMove[i], playouts, chrono::steady_clock::time_point::max(),
+                                        mixSeed(frontier[i].bookKey(toMove[i])));
+                value[i] = float(search.rootValue(best[i]));
+            };
+            workers.run(int(frontier.size()), searchPosition);
+
+            // store the answers and continue with every reply of the opponent
+            vector<HexBoard> next;
+            vector<Color> nextToMove;
+            vector<int> nextPlies;
+            for (int i = 0; i < int(frontier.size()); i++)
+            {
+                int move = frontier[i].rotatedHash < frontier[i].hash ? frontier[i].rotate(best[i]) : best[i];
+                entries.push_back(OpeningBook::Entry{frontier[i].bookKey(toMove[i]), move, value[i]});
+                if (plies[i] + 2 >= depth) continue;
+                HexBoard after(frontier[i]);
+                after.place(best[i] % size, best[i] / size, toMove[i]);
+                if (after.getWinner() != Color::NONE) continue;
+                Color opponent = (toMove[i] == Color::RED) ? Color::BLUE : Color::RED;
+                for (int p = 0; p < size * size; p++)
+                    if (after.getColor(p) == Color::NONE)
+                    {
+                        HexBoard reply(after);
+                        reply.place(p % size, p / size, opponent);
+                        if (!seen.insert(reply.bookKey(toMove[i])).second) continue;
+                        next.push_back(reply);
+                        nextToMove.push_back(toMove[i]);
+                        nextPlies.push_back(plies[i] + 2);
+                    }
+            }
+            frontier.swap(next);
+            toMove.swap(nextToMove);
+            plies.swap(nextPlies);
         }
+        cout << "Book size " << size << " done, " << entries.size() << " positions." << endl;
+    }
 
-        // print the final board and the final message (there can be no draw in this game)
-        print();
-        if (int(winner) == int(Color::BLUE))
-            cout << "Blue player wins! Congratulations!" << endl;
-        else
-            cout << "Red player wins! Congratulations!" << endl;
+    return OpeningBook::save(filename, entries, error);
+}
+
+// empty the board for a new game, the settings and the search memory are kept
+inline void HexBoard::clear()
+{
+    stopPondering();
+    for (int p = 0; p < size * size; p++)
+        setColor(p, Color::NONE);
+    numEmpty = size * size;
+    hash = mixSeed(uint64_t(size) << 40);
+    rotatedHash = hash;
+    lastMove = -1;
+    bits.clear();
+    groups.reset();
+    for (shared_ptr<MCTS>& t : trees) t->reset();
+}
+
+// forget what the tree search learned, the memory is kept
+inline void HexBoard::forgetSearch()
+{
+    for (shared_ptr<MCTS>& t : trees) t->reset();
+    if (table) table->clear();
+}
+
+// move the roots of the search trees to the position that was just played
+inline void HexBoard::advanceTree(int p)
+{
+    for (shared_ptr<MCTS>& t : trees) t->advance(p);
+}
+
+// search the current position in the background until stopPondering is called
+// the board must not change while the search runs
+inline void HexBoard::startPondering(Color toMove)
+{
+    if (!pondering || engine != Engine::MCTS || getWinner() != Color::NONE) return;
+    makeTrees();
+    for (shared_ptr<MCTS>& t : trees) t->clearStop();
+    ponderer = thread([this, toMove]
+    {
+        searchTrees(toMove, INT_MAX, chrono::steady_clock::time_point::max());
+    });
+}
+
+// end the background search and wait for it, before the board changes
+inline void HexBoard::stopPondering()
+{
+    if (!ponderer.joinable()) return;
+    for (shared_ptr<MCTS>& t : trees) t->stop();
+    ponderer.join();
+    for (shared_ptr<MCTS>& t : trees) t->clearStop(); // the next search must run to its own limits
+}
+
+// a text protocol engine on the standard input and output, with the commands of the
+// go text protocol that hex tools use, so a GUI or a match runner can drive the AI.
+// black plays first and is blue. a move is a column letter and a row number with a1 in
+// an acute corner, as in the other hex programs: the column is y and row r is x = size - r,
+// so black connects the first and the last row. the board is kept between games of the
+// same size, so the graph, the threads and the search memory stay warm, and a new size
+// replaces it, so only one search memory exists. nothing is printed unless showboard asks for it
+class GtpServer
+{
+    private:
+    const HexBoard& settings;              // the settings of new boards
+    unique_ptr<HexBoard> board;            // the board of the current size
+    int mainTime, byoTime, byoStones;      // the time settings in milliseconds, 0 for none
+    int timeLeft[2], stonesLeft[2];        // the clocks of blue and red from time_left, -1 if unknown
+
+    // make the board the given size and clear it for a new game
+    // a board of another size replaces it and takes over its transposition table,
+    // emptied, since the hashes of every size are different
+    void resize(int size)
+    {
+        if (board && board->size == size)
+        {
+            board->clear();
+            return;
+        }
+        shared_ptr<TranspositionTable> table = board ? board->table : nullptr;
+        board.reset();
+        board.reset(new HexBoard(size));
+        board->copySettings(settings);
+        board->table = table;
+        board->prepareSearch();
+        board->forgetSearch();
     }
 
-    // play a game of hex versus an AI opponent
-    void singlePlayer(bool playersTurn)
+    // parse a color, returns false if it isn't one
+    static bool parseColor(string word, Color& c)
     {
-        srand(time(NULL));              // seed the random generator
-        Color nextPlayer = Color::BLUE; // Blue plays first
-        Color winner     = Color::NONE; // the winner's color
+        for (char& ch : word) ch = char(tolower(ch));
+        if (word == "b" || word == "black")      c = Color::BLUE;
+        else if (word == "w" || word == "white") c = Color::RED;
+        else return false;
+        return true;
+    }
 
-        // loop until we have a winner
-        while (int(winner) == int(Color::NONE))
+    // parse a move like c5 or aa12, returns false if it isn't on the board
+    bool parseMove(const string& word, int& x, int& y) const
+    {
+        int column = 0, row = 0;
+        size_t i = 0;
+        for (; i < word.size() && isalpha((unsigned char)word[i]) && column <= board->size; i++)
+            column = column * 26 + (tolower(word[i]) - 'a' + 1);
+        if (i == 0 || column > board->size) return false;
+        size_t letters = i;
+        for (; i < word.size() && isdigit((unsigned char)word[i]) && row <= board->size; i++)
+            row = row * 10 + (word[i] - '0');
+        if (i == letters || i != word.size() || row < 1 || row > board->size) return false;
+        y = column - 1;
+        x = board->size - row;
+        return true;
+    }
+
+    // the name of a position
+    string moveName(int p) const
+    {
+        string column;
+        for (int c = p / board->size + 1; c > 0; c = (c - 1) / 26)
+            column.insert(column.begin(), char('a' + (c - 1) % 26));
+        return column + to_string(board->size - p % board->size);
+    }
+
+    // the milliseconds for the next move of the given color, 0 to use the playouts.
+    // the time left is shared by the stones of the period or by the most moves the
+    // player can still make, keeping a tenth in reserve
+    int budget(Color c) const
+    {
+        int side = c == Color::BLUE ? 0 : 1;
+        int moves = max((board->numEmpty + 1) / 2, 1);
+        if (timeLeft[side] >= 0)
+            return max(timeLeft[side] / 10 * 9 / (stonesLeft[side] > 0 ? stonesLeft[side] : moves), 1);
+        if (byoTime > 0 && byoStones > 0) return max(byoTime / 10 * 9 / byoStones, 1);
+        if (mainTime > 0) return max(mainTime / 10 * 9 / moves, 1);
+        return settings.moveTime;
+    }
+
+    // write a reply, success or failure, with the id of the command if it had one
+    static void reply(bool ok, const string& id, const string& text)
+    {
+        cout << (ok ? '=' : '?') << id << ' ' << text << "\n\n" << flush;
+    }
+
+    public:
+    // a server whose boards take the settings of the given one, starting with its size
+    GtpServer(const HexBoard& settings) : settings(settings), mainTime(0), byoTime(0), byoStones(0)
+    {
+        resize(settings.size);
+        timeLeft[0] = timeLeft[1] = stonesLeft[0] = stonesLeft[1] = -1;
+    }
+
+    // answer the commands until quit or the end of the input
+    void run()
+    {
+        static const char* COMMANDS[] = {"protocol_version", "name", "version", "known_command",
+            "list_commands", "quit", "boardsize", "clear_board", "play", "genmove", "showboard",
+            "time_settings", "time_left"};
+        string line;
+        while (getline(cin, line))
         {
-            print();
-            if (playersTurn) // player's move
+            // drop the comments and the control characters, skip the empty lines
+            line = line.substr(0, line.find('#'));
+            for (char& ch : line)
+                if (ch == '\t' || ch == '\r') ch = ' ';
+            istringstream words(line);
+            string id, command;
+            if (!(words >> command)) continue;
+            if (isdigit((unsigned char)command[0]))
             {
-                // ask the player for his move
-                int x, y;
-                cout << "It's your turn! Try to create an \"" << nextPlayer
-                     << "\" path from "
-                     << ((int(nextPlayer) == int(Color::BLUE)) ? "left to right.\n" : "top to bottom.\n");
-                cout << "Enter the row number    : "; cin >> y;
-                cout << "Enter the column number : "; cin >> x;
+                id = command;
+                if (!(words >> command)) continue;
+            }
 
-                // do the move and go on to the next player if it was valid
-                if (place(x,y,nextPlayer))
+            if (command == "protocol_version") reply(true, id, "2");
+            else if (command == "name")        reply(true, id, "GameofHex");
+            else if (command == "version")     reply(true, id, "1.0");
+            else if (command == "known_command" || command == "list_commands")
+            {
+                string name, list;
+                words >> name;
+                bool known = false;
+                for (const char* c : COMMANDS)
                 {
-                    winner = getWinner();
-                    nextPlayer = (int(nextPlayer) == int(Color::BLUE)) ? Color::RED : Color::BLUE;
-                    playersTurn = false;
+                    list += string(list.empty() ? "" : "\n") + c;
+                    known = known || name == c;
                 }
+                reply(true, id, command == "list_commands" ? list : known ? "true" : "false");
+            }
+            else if (command == "quit")
+            {
+                reply(true, id, "");
+                return;
+            }
+            else if (command == "boardsize")
+            {
+                // hex tools send the size once, twice or as NxN; only square boards are supported
+                string text;
+                getline(words, text);
+                for (char& ch : text)
+                    if (ch == 'x' || ch == 'X') ch = ' ';
+                istringstream sizes(text);
+                int width = 0, height = 0;
+                sizes >> width;
+                if (!(sizes >> height)) height = width;
+                if (width < 1 || width > 1000 || height != width)
+                    reply(false, id, "unacceptable size");
                 else
-                    cout << "That move was illegal." << endl;
+                {
+                    resize(width);
+                    reply(true, id, "");
+                }
             }
-            else // play an AI move and go on to the next player
+            else if (command == "clear_board")
             {
-                cout << "Thinking... " << endl;
-                playAIMove(nextPlayer);
-                winner = getWinner();
-                nextPlayer = (int(nextPlayer) == int(Color::BLUE)) ? Color::RED : Color::BLUE;
-                playersTurn = true;
-                cout << "Done! " << endl;
+                board->clear();
+                timeLeft[0] = timeLeft[1] = stonesLeft[0] = stonesLeft[1] = -1;
+                reply(true, id, "");
+            }
+            else if (command == "play")
+            {
+                string color, move;
+                Color c;
+                int x, y;
+                words >> color >> move;
+                if (!parseColor(color, c) || !parseMove(move, x, y)) reply(false, id, "invalid color or coordinate");
+                else if (!board->place(x, y, c))                     reply(false, id, "illegal move");
+                else                                                 reply(true, id, "");
+            }
+            else if (command == "genmove")
+            {
+                string color;
+                Color c;
+                words >> color;
+                if (!parseColor(color, c))                  reply(false, id, "invalid color");
+                else if (board->getWinner() != Color::NONE) reply(false, id, "the game is over");
+                else
+                {
+                    board->setMoveTime(budget(c));
+                    board->playAIMove(c);
+                    reply(true, id, moveName(board->lastMove));
+                }
+            }
+            else if (command == "showboard")
+            {
+                cout << '=' << id << "\n";
+                board->print();
+                cout << "\n" << flush;
+            }
+            else if (command == "time_settings")
+            {
+                int main, byo, stones;
+                if (!(words >> main >> byo >> stones)) reply(false, id, "syntax error");
+                else
+                {
+                    mainTime = main * 1000;
+                    byoTime = byo * 1000;
+                    byoStones = stones;
+                    reply(true, id, "");
+                }
+            }
+            else if (command == "time_left")
+            {
+                string color;
+                Color c;
+                int seconds, stones;
+                if (!(words >> color >> seconds >> stones) || !parseColor(color, c)) reply(false, id, "syntax error");
+                else
+                {
+                    int side = c == Color::BLUE ? 0 : 1;
+                    timeLeft[side] = seconds * 1000;
+                    stonesLeft[side] = stones;
+                    reply(true, id, "");
+                }
             }
+            else reply(false, id, "unknown command");
         }
+    }
+};
 
-        // print the final board and the final message (there can be no draw in this game)
-        print();
-        if (playersTurn)
-            cout << "You lost the game. Better luck next time." << endl;
-        else
-            cout << "You win! Congratulations!" << endl;
+// microbenchmarks of the primitives of the graph, the board and the AI on every board
+// size from 3 to 20. every case repeats its operation in growing batches until a batch
+// takes long enough, and reports the nanoseconds and allocations per operation and the
+// operations per second. the allocations are counted in builds with -DHEX_STATS only.
+// the results can be saved as a baseline and later runs compared against it
+class Benchmark
+{
+    private:
+    struct Result
+    {
+        string name;   // the case
+        int size;      // the board size
+        double ns;     // nanoseconds per operation
+        double allocs; // allocations per operation, NAN if they aren't counted
+    };
+
+    vector<Result> results;
+    map< pair<string, int>, double > baseline; // the ns per operation of a saved run
+    double minTime;                            // the seconds a measured batch must take at least
+
+    // the allocations so far, -1 if they aren't counted
+    static long long allocations()
+    {
+#ifdef HEX_STATS
+        long long sums[Stats::COUNTERS];
+        Stats::total(sums);
+        return sums[Stats::ALLOCATIONS];
+#else
+        return -1;
+#endif
+    }
+
+    // measure an operation that does opsPerCall operations on every call, print and keep the result
+    template <class Operation>
+    void measure(const string& name, int size, int opsPerCall, Operation operation)
+    {
+        operation(); // warm up the caches and the buffers
+        for (long long calls = 1; ; calls *= 2)
+        {
+            long long allocs = allocations();
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for (long long i = 0; i < calls; i++) operation();
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (seconds < minTime && calls < (1LL << 40)) continue;
+
+            double ops = double(calls) * opsPerCall;
+            Result r{name, size, seconds * 1e9 / ops, allocs < 0 ? NAN : (allocations() - allocs) / ops};
+            results.push_back(r);
+            print(r);
+            return;
+        }
+    }
+
+    // print a result, with the change against the baseline if it has the case
+    void print(const Result& r) const
+    {
+        cout << left << setw(16) << r.name << right << setw(5) << r.size << fixed << setprecision(1)
+             << setw(14) << r.ns;
+        if (isnan(r.allocs)) cout << setw(12) << "-";
+        else                 cout << setw(12) << setprecision(2) << r.allocs;
+        cout << setw(16) << setprecision(0) << 1e9 / r.ns;
+        auto base = baseline.find(make_pair(r.name, r.size));
+        if (base != baseline.end())
+            cout << setw(11) << showpos << setprecision(1) << 100.0 * (r.ns / base->second - 1.0) << "%" << noshowpos;
+        cout << endl;
+    }
+
+    public:
+    // a benchmark whose measured batches take at least the given milliseconds
+    Benchmark(int milliseconds = 50) : minTime(milliseconds / 1000.0) {}
+
+    // read a baseline saved by save, returns false and describes the problem in error if it can't
+    bool compare(const string& filename, string& error)
+    {
+        ifstream file(filename);
+        if (!file)
+        {
+            error = "can't read " + filename;
+            return false;
+        }
+        string line;
+        while (getline(file, line))
+        {
+            if (line.empty() || line[0] == '#') continue;
+            istringstream fields(line);
+            string name;
+            int size;
+            double ns;
+            if (fields >> name >> size >> ns) baseline[make_pair(name, size)] = ns;
+        }
+        return true;
+    }
+
+    // write the results as a baseline: a line per case with its name, size, ns and allocations per operation
+    bool save(const string& filename, string& error) const
+    {
+        ofstream file(filename);
+        file << "# case size ns/op allocs/op\n";
+        for (const Result& r : results)
+            file << r.name << ' ' << r.size << ' ' << r.ns << ' ' << (isnan(r.allocs) ? -1.0 : r.allocs) << '\n';
+        if (!file)
+        {
+            error = "can't write " + filename;
+            return false;
+        }
+        return true;
+    }
+
+    // run all the cases on the sizes from minSize to maxSize, the AI move uses the settings of the given board
+    void run(const HexBoard& settings, int minSize, int maxSize, uint64_t seed)
+    {
+        cout << left << setw(16) << "case" << right << setw(5) << "size" << setw(14) << "ns/op"
+             << setw(12) << "allocs/op" << setw(16) << "ops/s" << (baseline.empty() ? "" : "   vs base") << endl;
+        for (int size = minSize; size <= maxSize; size++)
+        {
+            Random rng(mixSeed(seed ^ uint64_t(size)));
+            HexBoard empty(size);
+            empty.copySettings(settings);
+            empty.setSeed(seed);
+
+            // a position with a third of the board filled, and a full random board
+            HexBoard middle(empty), full(empty);
+            for (int k = 0; k < size * size / 3; k++)
+            {
+                int p = int(rng.below(uint32_t(size * size)));
+                middle.place(p % size, p / size, k % 2 ? Color::RED : Color::BLUE);
+            }
+            vector<Color> moves;
+            full.randomFill(Color::BLUE, moves, rng);
+
+            volatile long long sink = 0; // keeps the compiler from dropping the results
+            Graph graph(empty);
+            measure("graph_neighbors", size, size * size, [&]
+            {
+                for (int v = 0; v < size * size; v++)
+                    for (int n : graph.neighbors(v)) sink = sink + n;
+            });
+            // a new edge is added and removed again, so every call sees the same graph
+            measure("graph_add", size, 1, [&]
+            {
+                graph.add(0, size * size - 1);
+                graph.remove(0, size * size - 1);
+            });
+            measure("color_connected", size, 1, [&]
+            {
+                sink = sink + full.colorConnected(size * size, size * size + 1);
+            });
+            // the master nodes are the terminals, the buffers are reused by every call
+            vector<int> sides{size * size, size * size + 1, size * size + 2, size * size + 3};
+            ColoredGraph::Components components;
+            measure("label", size, 1, [&]
+            {
+                middle.label(components, sides);
+                sink = sink + components.count();
+            });
+            measure("board_copy", size, 1, [&]
+            {
+                HexBoard copy(middle);
+                sink = sink + copy.numEmpty;
+            });
+            HexBoard temp(middle);
+            measure("playout", size, 1, [&]
+            {
+                temp.restore(middle);
+                sink = sink + int(temp.randomFill(Color::BLUE, moves, rng));
+            });
+            PlayoutKernel kernel(size);
+            kernel.setPosition(middle.colors);
+            measure("kernel_playout", size, PlayoutKernel::LANES, [&]
+            {
+                sink = sink + kernel.play(Color::BLUE, Color::BLUE, rng);
+            });
+            measure("get_winner", size, 1, [&]
+            {
+                sink = sink + int(middle.getWinner());
+            });
+            // every call starts with empty trees and an empty transposition table, so all
+            // the calls do the same search; the memory is allocated before the clock starts
+            temp.prepareSearch();
+            measure("play_ai_move", size, 1, [&]
+            {
+                temp.restore(middle);
+                temp.forgetSearch();
+                temp.playAIMove(Color::BLUE);
+            });
+        }
     }
 };
 
+// the engine of the given name, returns false if there is none
+bool parseEngine(const string& name, Engine& e)
+{
+    if (name == "mcts")      e = Engine::MCTS;
+    else if (name == "flat") e = Engine::FLAT;
+    else if (name == "amaf") e = Engine::AMAF;
+    else return false;
+    return true;
+}
+
+// print what went wrong with the command line and how to use it, returns the exit status
+int usage(const string& problem)
+{
+    cout << problem << "\n"
+         << "usage: hex [--threads N] [--engine mcts|flat|amaf] [--playouts N] [--time MS] [--ponder] [--hash MB]\n"
+         << "           [--seed S] [--book FILE] [--make-book FILE [--size N] [--book-depth PLIES]]\n"
+         << "           [--selfplay GAMES [--size N]] [--gtp [--size N]]\n"
+         << "           [--match GAMES --versus ENGINE[:PLAYOUTS] [--size N]]\n"
+         << "           [--bench [--size N] [--save FILE] [--compare FILE]]" << endl;
+    return 1;
+}
+
 // launches a game of hex
-int main()
+// usage: hex [--threads N] [--engine mcts|flat|amaf] [--playouts N] [--time MS] [--ponder] [--hash MB]
+//            [--seed S] [--book FILE] [--make-book FILE [--size N] [--book-depth PLIES]]
+//            [--selfplay GAMES [--size N]] [--gtp [--size N]]
+//            [--match GAMES --versus ENGINE[:PLAYOUTS] [--size N]]
+//            [--bench [--size N] [--save FILE] [--compare FILE]]
+int main(int argc, char* argv[])
 {
-    // get the board size from the user and create the board
-    int size = 0;
-    while (size < 1 || size > 20)
+    // the number of threads for the AI, all the hardware threads by default
+    // and one for the benchmarks, so their results don't depend on the machine
+    int threads = 0;
+    Engine engine = Engine::MCTS;
+    int playouts = 50000;
+    int moveTime = 0;
+    bool ponder = false;
+    int hashSize = 64;
+    string bookFile = "hex.book", makeBook;
+    int size = 0, bookDepth = 3;
+    int selfPlayGames = 0;
+    bool gtp = false;
+    int matchGames = 0;
+    Engine versus = Engine::FLAT; // the engine of the match opponent
+    int versusPlayouts = 0;       // its playouts, 0 for the same as the AI's
+    bool bench = false;
+    string saveBench, compareBench;
+    uint64_t seed = uint64_t(time(NULL));
+    bool seeded = false; // the benchmarks use a fixed seed unless one is given
+    for (int i = 1; i < argc; i++)
+    {
+        string option = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (option == "--ponder")                    ponder = true;
+        else if (option == "--gtp")                  gtp = true;
+        else if (option == "--bench")                bench = true;
+        else if (option == "--save" && hasValue)     saveBench = argv[++i];
+        else if (option == "--compare" && hasValue)  compareBench = argv[++i];
+        else if (option == "--threads" && hasValue)  threads = atoi(argv[++i]);
+        else if (option == "--playouts" && hasValue) playouts = atoi(argv[++i]);
+        else if (option == "--time" && hasValue)     moveTime = atoi(argv[++i]);
+        else if (option == "--hash" && hasValue)     hashSize = atoi(argv[++i]);
+        else if (option == "--engine" && hasValue)
+        {
+            if (!parseEngine(argv[++i], engine)) return usage("unknown engine " + string(argv[i]));
+        }
+        else if (option == "--book" && hasValue)     bookFile = argv[++i];
+        else if (option == "--make-book" && hasValue) makeBook = argv[++i];
+        else if (option == "--size" && hasValue)     size = atoi(argv[++i]);
+        else if (option == "--book-depth" && hasValue) bookDepth = atoi(argv[++i]);
+        else if (option == "--selfplay" && hasValue) selfPlayGames = atoi(argv[++i]);
+        else if (option == "--match" && hasValue)    matchGames = atoi(argv[++i]);
+        else if (option == "--versus" && hasValue)
+        {
+            string name = argv[++i];
+            size_t colon = name.find(':');
+            if (colon != string::npos) versusPlayouts = atoi(name.c_str() + colon + 1);
+            if (!parseEngine(name.substr(0, colon), versus)) return usage("unknown engine " + name.substr(0, colon));
+        }
+        else if (option == "--seed" && hasValue)
+        {
+            seed = strtoull(argv[++i], nullptr, 10);
+            seeded = true;
+        }
+        else return usage("unknown option or missing value " + option);
+    }
+
+    // benchmark the primitives on one size or on all the sizes from 3 to 20
+    if (bench)
+    {
+        HexBoard settings(1);
+        settings.setThreads(max(threads, 1));
+        settings.setEngine(engine, playouts);
+        settings.setMoveTime(moveTime);
+        settings.setHashSize(hashSize);
+        Benchmark benchmark;
+        string error;
+        if (!compareBench.empty() && !benchmark.compare(compareBench, error)) cout << error << endl;
+        benchmark.run(settings, size ? size : 3, size ? size : 20, seeded ? seed : 1);
+        if (!saveBench.empty() && !benchmark.save(saveBench, error))
+        {
+            cout << error << endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (threads == 0) threads = int(thread::hardware_concurrency());
+
+    // generate an opening book offline, for one board size or for all of them
+    if (!makeBook.empty())
+    {
+        string error;
+        bool ok = HexBoard::makeBook(makeBook, size ? size : 1, size ? size : 20,
+                                     bookDepth, playouts, threads, error);
+        if (!ok) cout << error << endl;
+        return ok ? 0 : 1;
+    }
+
+    // self-play games, matches and the text protocol start on 11x11 boards unless a size is given
+    if ((selfPlayGames > 0 || matchGames > 0 || gtp) && size == 0) size = 11;
+
+    // get the board size from the user if it wasn't given and create the board
+    while (size < 1 || size > 1000)
     {
-        cout << "Enter the dimension of the hex board (1-20) : ";
+        cout << "Enter the dimension of the hex board (1-1000) : ";
         cin >> size;
     }
     HexBoard hex(size);
+    hex.setThreads(threads);
+    hex.setEngine(engine, playouts);
+    hex.setMoveTime(moveTime);
+    hex.setPondering(ponder);
+    hex.setHashSize(hashSize);
+    hex.setSeed(seed);
+
+    // use the opening book if there is one, the default file is optional
+    string error;
+    if (!hex.setBook(bookFile, error) && bookFile != "hex.book")
+        cout << error << endl;
+
+    // serve the text protocol until quit, the board sizes are set by its commands
+    if (gtp)
+    {
+        GtpServer(hex).run();
+        return 0;
+    }
+
+    // play the AI against another engine or playout count, the opponent takes the other settings
+    if (matchGames > 0)
+    {
+        HexBoard opponent(hex);
+        opponent.setEngine(versus, versusPlayouts > 0 ? versusPlayouts : playouts);
+        hex.match(matchGames, opponent, seed, threads);
+        return 0;
+    }
+
+    // play the AI against itself without prompts
+    if (selfPlayGames > 0)
+    {
+        hex.selfPlay(selfPlayGames, seed);
+        return 0;
+    }
 
     // ask if the user wants to play multiplayer or vs AI
     string input;
@@ -1,28 +1,104 @@
 #include <vector> //c++ library for vectors
 #include <iostream> //standard input/output library of c++
 #include <ctime> //c++ library for timing
+#include <chrono> //c++ library for the monotonic clock of the move deadline
+#include <cstdint> //c++ library for the fixed size integers of the random generator
+#include <cstdlib> //c standard library, used for reading the seed
+#include <string> //c++ library for the command line options and the names of the benchmarks
+#include <fstream> //c++ library for the baseline files of the benchmarks
+#include <sstream> //c++ library for reading the lines of a baseline
+#include <iomanip> //c++ library for the columns of the benchmark results
+#include <map> //c++ library for the baseline results by case and size
+#include <cmath> //c++ library for the missing allocation counts
+#include <new> //c++ library for bad_alloc
 using namespace std;
 class point;//forward declaration
 class player;//forward declaration
 class hexg;//forward declaration
 class machine;//forward declaration
-bool simulate(int , int );//forward declaration
+class generator;//forward declaration
+int simulate(int , int , const hexg* , generator& );//forward declaration
+bool isLegal(const point& );//forward declaration
+void benchmark(const string& , const string& );//forward declaration
 typedef enum coverage{NONE, RED, BLUE} coverage; //this will be used for deciding which palyer owns which point
-typedef vector<point*> vp; //instead of writing "vector< vector<point> >" all the time, i'll just type "vp"
+typedef vector<point> vp; //the board is one contiguous vector of points, the point (i,j) is stored at i*dimension+j
 typedef vector<int> vi; //instead of writing "vector<int>" all the time, i'll just type "vi"
 inline void itest(int i){cout<<"test "<<i<<endl;};
 
+#ifdef HEX_STATS
+long long allocations = 0; //the number of allocations so far, for the benchmarks
+__attribute__((noinline)) void* operator new(size_t n) //count every allocation, not inlined so the compiler sees a matching pair with delete
+{
+	allocations++;
+	if(void* p = malloc(n ? n : 1)) return p;
+	throw bad_alloc();
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept {free(p);} //not inlined, so the compiler doesn't pair the free with the new of the caller
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {free(p);} //the sized version
+#endif
+
+class generator //a fast random number generator (xoshiro256**) for the simulations, every machine has its own
+{
+private:
+	uint64_t s[4]; //the state of the generator
+	static uint64_t rotl(uint64_t x, int k) //rotate the bits of x to the left
+	{
+		return (x<<k) | (x>>(64-k));
+	}
+public:
+	generator(uint64_t seed){setSeed(seed);} //constructor
+	void setSeed(uint64_t seed) //the same seed always gives the same numbers
+	{
+		for(int i=0; i<4; i++) //splitmix64 spreads the seed over the whole state
+		{
+			seed += 0x9e3779b97f4a7c15ULL;
+			uint64_t z = seed;
+			z = (z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+			z = (z^(z>>27))*0x94d049bb133111ebULL;
+			s[i] = z^(z>>31);
+		}
+	}
+	uint64_t next() //the next 64 random bits
+	{
+		uint64_t result = rotl(s[1]*5,7)*9;
+		uint64_t t = s[1]<<17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3],45);
+		return result;
+	}
+	uint32_t below(uint32_t n) //a random number from 0 to n-1 without the bias of rand()%n (Lemire's method)
+	{
+		uint64_t m = (next()>>32)*n;
+		if(uint32_t(m)<n) //only then the result may be biased
+		{
+			uint32_t threshold = uint32_t(-n)%n;
+			while(uint32_t(m)<threshold)
+			{
+				m = (next()>>32)*n;
+			}
+		}
+		return uint32_t(m>>32);
+	}
+	void shuffle(vi& v) //put the elements in a random order (Fisher-Yates)
+	{
+		for(int k=int(v.size())-1; k>0; k--)
+		{
+			swap(v[k], v[below(k+1)]);
+		}
+	}
+};
+
 class point //this is the data type that'll be used as our board game's squares
 {
 private:
 	int x,y;
 	coverage cov; //this shows which player owns this position
 public:
-	friend bool check(vp , point*); //friendly access declaration
-	friend bool move(int dimension, point& , point& ); //friendly access declaration
-	friend bool isLegal(int , player& ); //friendly access declaration
-	friend bool gameOver(hexg , player& ); //friendly access declaration
-	friend ostream& operator<<(ostream& , point& ); //friendly access declaration
+	friend ostream& operator<<(ostream& , const point& ); //friendly access declaration
 	point(int x, int y):x(x),y(y),cov(NONE){}; //constructor for point
 	~point(){}; //destructor for point
 	void setCoverage(int k, int l, coverage c) //this function sets this point under a player's colour (coverage c)
@@ -30,7 +106,7 @@ public:
 		if(k==x && l==y)
 			cov =c;
 	}
-	coverage getCoverage() //this function returns the coverage of the point
+	coverage getCoverage() const //this function returns the coverage of the point
 	{
 		return cov;
 	}
@@ -38,15 +114,13 @@ public:
 class player //this is the data type that 'll be used as the player
 {
 protected:
-	vp path; //vector containing the player's path
 	coverage colour; 
 	int x,y;
 public:
 	friend class hexg; //friendly access declaration
-	friend bool isLegal(point& ); //friendly access declaration
 	friend class point; //friendly access declaration
-	friend bool gameOver(hexg , player& ); //friendly access declaration
-	friend int simulate(int , int , hexg* ); //friendly access declaration
+	friend bool gameOver(const hexg& , const player& ); //friendly access declaration
+	friend int simulate(int , int , const hexg* , generator& ); //friendly access declaration
 	player(){} //constructor
 	~player(){} //destructor
 	virtual void chooseMove() //this function is used for making the next move of each palyer
@@ -62,7 +136,7 @@ public:
 	{
 		colour=c;
 	}
-	coverage getTurn() //this is used for checking the player's turn
+	coverage getTurn() const //this is used for checking the player's turn
 	{
 		return colour;
 	}
@@ -73,72 +147,56 @@ class machine: public player //publicly derived class
 private:
 	int chosen1,chosen2; //temporary coordinates used for simulation
 	hexg* base; //a pointer to the class that will be conatining this class
+	int budget; //the thinking time for each move in milliseconds
+	generator random; //the random numbers of the simulations
 public:
 	friend void setCoverage(); //friendly access declaration
 	friend class hexg; //friendly access declaration
+	machine():budget(2000),random(time(NULL)){} //constructor, two seconds per move by default
 	void setBase(hexg* g) //set the value of pointer base
 	{
 			base=g;
 	}
-	void chooseMove(int dimension, vector< vp > board) //this chooses the move for AI
+	void setBudget(int milliseconds) //set the thinking time for each move
+	{
+		budget=milliseconds;
+	}
+	void setSeed(uint64_t seed) //set the seed of the simulations, so a game can be repeated
+	{
+		random.setSeed(seed);
+	}
+	void chooseMove(int dimension, const vp& board) //this chooses the move for AI
 	{
-		dimension++; //we offset the dimension by 1 to get right correspondence in the game's board
 		cout<<"Hmm, interesting.. Let me think.."<<endl;
-		vector< vi > odds; //two dimensional vector that conatains the odds
-		for(int i=0; i<dimension; i++) //create a two-dimensional matrix with pointers to points
-		{
-			vi row; //a single dimensional matrix, only to be used for the initialization of odds
-			for(int j=0; j<dimension; j++)
-			{
-				if(!i) //enumerate the nodes at the top and the leftmost of the graph
-				{
-					row.push_back(j-1);
-				}
-				else if(!j) //enumerate the nodes at the top and the leftmost of the graph
-					{
-						row.push_back(i-1);
-					}
-					else
-					{
-						row.push_back(NULL); //initialize every odd at the NULL value
-					}
-			}
-			odds.push_back(row);
-		}
-		odds[0][0]=99; //of no importance
-		time_t end = time(NULL) + 2; //set the time duration at 1 minute
-		while(time(NULL) <= end)
+		vi odds(board.size(), 0); //the wins of every point, in the same order as the board
+		vi trials(board.size(), 0); //the simulations of every point, the last sweep may stop before it reaches all of them
+		chrono::steady_clock::time_point end = chrono::steady_clock::now() + chrono::milliseconds(budget); //the deadline for this move
+		bool timeUp = false; //checked after every simulation, so we can stop in the middle of a sweep
+		while(!timeUp)
 		{
-			for(int i=1; i<odds.size(); i++)
+			for(int i=0; i<dimension && !timeUp; i++)
 			{
-				for(int j=1; j<odds.size(); j++)
+				for(int j=0; j<dimension && !timeUp; j++)
 				{
-					if(isLegal(*(board[i-1][j-1]))) //if the move is plausible
-					{
-						odds[i][j] += simulate(i,j,base);
-					}
-					else //if not
+					if(isLegal(board[i*dimension+j])) //if the move is plausible
 					{
-						odds[i][j]=0;
+						odds[i*dimension+j] += simulate(i,j,base,random);
+						trials[i*dimension+j]++;
 					}
+					timeUp = chrono::steady_clock::now() >= end; //the odds so far are kept if the time is up
 				}
 			}
 		}
-		chosen1 = 1; //initialization
-		chosen2 = 1; //initialization
-		for(int i=1; i<odds.size(); i++)
+		int best = -1; //no plausible move found yet
+		for(int k=0; k<int(board.size()); k++)
 		{
-			for(int j=1; j<odds.size(); j++)
-			{
-				if(odds[chosen1][chosen2]<odds[i][j] && isLegal(*(board[i-1][j-1])))
-				{// use the plausible move with the highest success rate
-					chosen1 = i;
-					chosen2 = j;
-				}
+			if(isLegal(board[k]) && trials[k]>0 && (best<0 || (long long)odds[best]*trials[k]<(long long)odds[k]*trials[best]))
+			{// use the plausible move with the highest success rate, compared without division
+				best = k;
 			}
 		}
-		chosen1--; //offset like above
-		chosen2--; //offset like above
+		chosen1 = best/dimension;
+		chosen2 = best%dimension;
 	}
 };
 void getTurn(player& p, machine& pc) //this function lets the player decide if he's playing first
@@ -165,30 +223,40 @@ void getTurn(player& p, machine& pc) //this function lets the player decide if h
 class hexg //this data type will be used as our game
 {
 private:
-	vector< vp > board;
+	vp board; //all the points of the board, row after row
 	int dimension;
-public:
-	friend bool gameOver(hexg , player& ); //friendly access declaration
-	friend bool isLegal(point& ); //friendly access declaration
-	friend int simulate(int , int , hexg* );
-	player pl; //human player
-	machine pc; //AI
-	hexg() //constructor
+	void makeBoard() //fill the board row after row with free points
 	{
-		getInfo(); //get the needed data to set the game
-		for(int i=0; i<dimension; i++) //create a two-dimensional matrix with pointers to points
+		board.reserve(dimension*dimension);
+		for(int i=0; i<dimension; i++)
 		{
-			vp row;
 			for(int j=0; j<dimension; j++)
 			{
-				row.push_back(new point(i,j));
+				board.push_back(point(i,j));
 			}
-			board.push_back(row);
 		}
+	}
+public:
+	friend bool gameOver(const hexg& , const player& ); //friendly access declaration
+	friend int simulate(int , int , const hexg* , generator& ); //friendly access declaration
+	friend void benchmark(const string& , const string& ); //friendly access declaration
+	player pl; //human player
+	machine pc; //AI
+	hexg() //constructor
+	{
+		getInfo(); //get the needed data to set the game
+		makeBoard();
 		getTurn(pl,pc); //ask the player if he wants to play first
 		pc.setBase(this);
 	}
-	hexg(hexg& a):board(a.board), dimension(a.dimension), pl(a.pl), pc(a.pc){}; //copy constructor
+	hexg(int dimension):dimension(dimension) //constructor without questions, the player is blue and the AI is red
+	{
+		makeBoard();
+		pl.turn(BLUE);
+		pc.turn(RED);
+		pc.setBase(this);
+	}
+	hexg(const hexg& a):board(a.board), dimension(a.dimension), pl(a.pl), pc(a.pc){}; //copy constructor, copies the points themselves
 	~hexg(){} //destructor
 	inline void getInfo() //this function acquires the data needed to set the dimension of the board
 	{
@@ -197,32 +265,23 @@ public:
 	}
 	void printBoard() //this function shows the board on screen
 	{
-		for(int i=0; i<board.size(); i++)
+		for(int i=0; i<dimension; i++)
 		{
 			cout<<"  "<<i;
 		}
 		cout<<endl;
-		for(int i=0; i<board.size(); i++)
+		for(int i=0; i<dimension; i++)
 		{
 			for(int space=0; space<i; space++)
 			{
 				cout<<" ";
 			}
-			if(i!=board.size())
-			{
-				cout<<i;
-			}
-			for(int j=0; j<board.size(); j++)
+			cout<<i;
+			for(int j=0; j<dimension; j++)
 			{
-				if(j!=board.size()-1)
-				{
-					cout<<*board[i][j];
-				}
-				else if(j==board.size()-1)
-				{
-					cout<<*board[i][j]<<endl;
-				}
+				cout<<board[i*dimension+j];
 			}
+			cout<<endl;
 		}
 	}
 	void setCoverage() //set the colour of the points
@@ -231,76 +290,49 @@ public:
 		{
 			pc.chooseMove(dimension, board);
 			cout<<"next pc move = ("<<pc.chosen1<<" , "<<pc.chosen2<<")"<<endl;
-			(board[pc.chosen1][pc.chosen2])->setCoverage(pc.chosen1,pc.chosen2,pc.colour);
-			pc.path.push_back(board[pc.chosen1][pc.chosen2]);
+			board[pc.chosen1*dimension+pc.chosen2].setCoverage(pc.chosen1,pc.chosen2,pc.colour);
 			printBoard();
 		}
 		if(!(gameOver(*this, this->pc)))
 		{
 			pl.chooseMove(); //player makes move
-			while(!(pl.path.size()==0 || (pl.path.size()!=0 && isLegal(*(board[pl.x][pl.y]))))) //checking the validation of the chosen move
+			while(pl.x<0 || pl.x>=dimension || pl.y<0 || pl.y>=dimension || !isLegal(board[pl.x*dimension+pl.y])) //checking the validation of the chosen move
 			{
 				cout<<"Please select a valid move."<<endl;
 				pl.chooseMove(); //if the move isn't permitted, make another
 			}
-			for(int i=0; i<board.size();i++)
-			{
-				for(int j=0;j<board.size(); j++)
-				{
-					if(i==pl.x && j==pl.y)
-					{
-						(*board[i][j]).setCoverage(i,j,pl.colour); //if the move is permitted set the according colour to the chosen point
-						pl.path.push_back(board[i][j]); //add the point to the path of each player
-					}
-				}
-			}
+			board[pl.x*dimension+pl.y].setCoverage(pl.x,pl.y,pl.colour); //if the move is permitted set the according colour to the chosen point
 		}
 		if(pc.getTurn()==BLUE && !(gameOver(*this, this->pl)))
 		{
 			pc.chooseMove(dimension, board);
 			cout<<"next pc move = ("<<pc.chosen1<<" , "<<pc.chosen2<<")"<<endl;
-			(board[pc.chosen1][pc.chosen2])->setCoverage(pc.chosen1,pc.chosen2,pc.colour);
-			pc.path.push_back(board[pc.chosen1][pc.chosen2]);
+			board[pc.chosen1*dimension+pc.chosen2].setCoverage(pc.chosen1,pc.chosen2,pc.colour);
 		}
 	}
 };
-int simulate(int x, int y, hexg* test) //this function estimates the success rate of each move
+int simulate(int x, int y, const hexg* test, generator& random) //this function estimates the success rate of each move
 {
-	hexg a(*test); //create a temporary copycat of the game
-	a.board[x][y]->setCoverage(x,y,RED);
-	while(!(gameOver(a,a.pl)) && !(gameOver(a, a.pc)))
-	{
-		int randChoise1 = (rand()%(a.dimension-1))+1;//random number
-		int randChoise2 = (rand()%(a.dimension-1))+1;//random number
-		while(!(a.board[randChoise1][randChoise2]->getCoverage()==NONE))
-		{
-			randChoise1 = (rand()%(a.dimension-1))+1;
-			randChoise2 = (rand()%(a.dimension-1))+1;
-		}
-		a.board[randChoise1][randChoise2]->setCoverage(randChoise1,randChoise2,BLUE);
-		a.pl.path.push_back(a.board[randChoise1][randChoise2]);
-		randChoise1 = (rand()%(a.dimension-1))+1;
-		randChoise2 = (rand()%(a.dimension-1))+1;
-		while(!(a.board[randChoise1][randChoise2]->getCoverage()==NONE))
+	hexg a(*test); //create a temporary copycat of the game, it has its own points
+	coverage mine = a.pc.colour; //the simulation is played for the AI
+	coverage other = (mine==RED) ? BLUE : RED;
+	a.board[x*a.dimension+y].setCoverage(x,y,mine);
+	vi empty; //the free points, they will be filled in random order
+	for(int k=0; k<int(a.board.size()); k++)
+	{
+		if(a.board[k].getCoverage()==NONE)
 		{
-			randChoise1 = (rand()%(a.dimension-1))+1;
-			randChoise2 = (rand()%(a.dimension-1))+1;
+			empty.push_back(k);
 		}
-		a.board[randChoise1][randChoise2]->setCoverage(randChoise1,randChoise2,RED);
-		a.pc.path.push_back(a.board[randChoise1][randChoise2]);
-	}
-	if(gameOver(a,a.pl))
-	{
-		a.~hexg();
-		return 1;
 	}
-	else if(gameOver(a,a.pc))
+	random.shuffle(empty); //shuffle the free points
+	for(int k=0; k<int(empty.size()); k++) //the opponent plays next, then the players alternate
 	{
-		a.~hexg();
-		return 0;
+		a.board[empty[k]].setCoverage(empty[k]/a.dimension, empty[k]%a.dimension, (k%2==0) ? other : mine);
 	}
+	return gameOver(a, a.pc); //a full hex board always has exactly one winner
 };
-ostream& operator<<(ostream& out, point& p) //overload the << operator to show the board in the right form
+ostream& operator<<(ostream& out, const point& p) //overload the << operator to show the board in the right form
 { 
 	if(p.getCoverage()==NONE)
 	{
@@ -317,7 +349,7 @@ ostream& operator<<(ostream& out, point& p) //overload the << operator to show t
 	return out;
 };
 
-bool isLegal(point& p) //checks if the point is free
+bool isLegal(const point& p) //checks if the point is free
 {
 	if(p.getCoverage()==0)
 	{
@@ -329,163 +361,168 @@ bool isLegal(point& p) //checks if the point is free
 	}
 }
 
-bool move(int dimension, point& p, point& q) //this function checks if the chosen move is legal
+bool gameOver(const hexg& g, const player& pl) //this function checks if there is a winner
 {
-	dimension--; //because the board starts from 0, the last point will be dimension-1
-	//below are some fixed cases that may occur while checking (I named in the order I thought of them)
-	bool first = ((p.x==q.x) && ((p.y==(q.y)-1) || (p.y==(q.y)+1)));
-	bool second = ((p.x==((q.x)-1)) && ((p.y==(q.y)) || (p.y==(q.y)+1)));
-	bool third = ((p.x==((q.x)+1)) && ((p.y==q.y) || (p.y==(q.y)-1)));
-	bool fourth = ((p.x==q.x) && (p.y==(q.y)-1));
-	bool fifth = ((p.x==q.x) && (p.y==(q.y)+1));
-	bool sixth = ((p.x==((q.x)-1)) && (p.y==q.y));
-	bool seventh = ((p.x==((q.x)-1)) && (p.y==(q.y)+1));
-	bool eigth = ((p.x==((q.x)+1)) && (p.y==q.y));
-	bool ninth = ((p.x==((q.x)+1)) && (p.y==(q.y)-1));
-
-	if((q.x==0 && q.y==0) && ((p.x==(q.x) && (p.y==(q.y)+1)) || (p.x==(q.x)+1 && (p.y==(q.y)))))
-	{ 
-		return 1; //special point(0,0) has 2 edges
-	}
-	else if((q.x==0 && q.y==dimension) && ((p.x==(q.x) && (p.y==(q.y)-1)) || (p.x==((q.x)+1) && (p.y==(q.y)))))
-	{
-		return 1; //special point(0,dimension-1) has 2 edges
-	}
-	else if((q.x==dimension && q.y==0) && ((p.x==(q.x) && (p.y==(q.y)+1)) || (p.x==(q.x)-1 && (p.y==(q.y)))))
-	{
-		return 1; //special point(dimension-1,0) has 2 edges
-	}
-	else if((q.x==dimension && q.y==dimension) && ((p.x==(q.x) && (p.y==(q.y)-1)) || (p.x==((q.x)-1) && (p.y==(q.y)))))
-	{
-		return 1; //special point(dimension-1,dimension-1) has 2 edges
+	//the neighbours of (x,y) are (x,y-1), (x,y+1), (x-1,y), (x-1,y+1), (x+1,y) and (x+1,y-1)
+	static const int dx[6] = {0, 0, -1, -1, 1, 1};
+	static const int dy[6] = {-1, 1, 0, 1, 0, -1};
+	int n = g.dimension;
+	vector<bool> seen(n*n, false); //points already reached from the first side
+	vi stack; //points reached but not yet expanded
+	for(int s=0; s<n; s++) //RED starts from y=0, BLUE starts from x=0
+	{
+		int k = (pl.colour==RED) ? s*n : s;
+		if(g.board[k].getCoverage()==pl.colour)
+		{
+			seen[k] = true;
+			stack.push_back(k);
+		}
 	}
-	else if((q.x==0 && q.y!=0 && q.y!=dimension) && (first || third))
+	while(!stack.empty())
 	{
-		return 1; //special points in the x=0 axis have 4 edges
+		int x = stack.back()/n;
+		int y = stack.back()%n;
+		stack.pop_back();
+		if(((pl.colour==RED) ? y : x)==n-1) //we reached the other side
+		{
+			return 1;
+		}
+		for(int d=0; d<6; d++)
+		{
+			int i = x+dx[d];
+			int j = y+dy[d];
+			if(i>=0 && i<n && j>=0 && j<n && !seen[i*n+j] && g.board[i*n+j].getCoverage()==pl.colour)
+			{
+				seen[i*n+j] = true;
+				stack.push_back(i*n+j);
+			}
+		}
 	}
-	else if((q.x==dimension && q.y!=0 && q.y!=dimension) && (first || second))
-	{
-		return 1; //special points in the x=dimension-1 axis have 4 edges
+	return 0;
+};
+
+template <class F> double measure(const char* name, int n, F operation, map<string, double>& baseline, ofstream& save) //time an operation in growing batches until a batch takes 50 ms, print and save the result
+{
+	operation(); //warm up the caches
+	for(long long calls=1; ; calls*=2)
+	{
+#ifdef HEX_STATS
+		long long before = allocations; //the allocations before the batch
+#endif
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(long long i=0; i<calls; i++)
+		{
+			operation();
+		}
+		double seconds = chrono::duration<double>(chrono::steady_clock::now()-start).count();
+		if(seconds<0.05) continue; //too short to be measured well
+		double ns = seconds*1e9/calls; //nanoseconds per operation
+#ifdef HEX_STATS
+		double allocs = double(allocations-before)/calls; //allocations per operation
+#else
+		double allocs = NAN; //not counted in this build
+#endif
+		cout<<left<<setw(16)<<name<<right<<setw(5)<<n<<fixed<<setprecision(1)<<setw(14)<<ns;
+		if(isnan(allocs)) cout<<setw(12)<<"-";
+		else cout<<setw(12)<<setprecision(2)<<allocs;
+		cout<<setw(16)<<setprecision(0)<<1e9/ns;
+		string key = string(name)+" "+to_string(n); //the case and the size
+		if(baseline.count(key)) //the change against the baseline
+		{
+			cout<<setw(11)<<showpos<<setprecision(1)<<100.0*(ns/baseline[key]-1.0)<<"%"<<noshowpos;
+		}
+		cout<<endl;
+		if(save.is_open())
+		{
+			save<<key<<' '<<ns<<' '<<(isnan(allocs) ? -1.0 : allocs)<<'\n';
+		}
+		return ns;
 	}
-	else if((q.y==0 && q.x!=0 && q.x!=dimension) && (fifth || eigth || sixth || seventh))
-	{
-		return 1; //special points in the y=0 axis have 4 edges
-	} 
-	else if((q.y==dimension && q.x!=0 && q.x!=dimension) && (fourth || sixth || eigth || ninth))
-	{
-		return 1; //special points in the y=dimension-1 axis have 4 edges
-	} 
-	else if((q.x!=0 && q.x!=dimension && q.y!=0 && q.y!=dimension) && (first || second || third))
+}
+
+void benchmark(const string& saveFile, const string& compareFile) //time gameOver and simulate on every board size from 3 to 20, in the format of 1.cpp's benchmarks
+{
+	map<string, double> baseline; //the ns per operation of a saved run by case and size
+	if(!compareFile.empty())
 	{
-		return 1; //every other point has 6 edges
+		ifstream file(compareFile.c_str());
+		if(!file) cout<<"can't read "<<compareFile<<endl;
+		string line;
+		while(getline(file, line))
+		{
+			istringstream fields(line);
+			string name;
+			int n;
+			double ns;
+			if(line[0]!='#' && fields>>name>>n>>ns) baseline[name+" "+to_string(n)] = ns;
+		}
 	}
-	else
+	ofstream save; //the results as a new baseline, if a file is given
+	if(!saveFile.empty())
 	{
-		return 0; //every other chosen move is illegal
+		save.open(saveFile.c_str());
+		save<<"# case size ns/op allocs/op\n";
 	}
-};
-
-bool check(vp temp, point* next) //checks if a point is in the closed set for the path
-{
-	for(vp::iterator k=temp.begin(); k!=temp.end(); k++)
+	cout<<left<<setw(16)<<"case"<<right<<setw(5)<<"size"<<setw(14)<<"ns/op"<<setw(12)<<"allocs/op"<<setw(16)<<"ops/s"<<(baseline.empty() ? "" : "   vs base")<<endl;
+	generator random(1); //a fixed seed, so every run measures the same boards
+	int sink = 0; //keeps the results in use
+	for(int n=3; n<=20; n++)
 	{
-		if(((*k)->x)==((*next).x) && ((*k)->y)==((*next).y))
+		hexg empty(n); //the empty board for the simulations
+		hexg full(n); //a full random board for the winner check
+		vi cells(n*n);
+		for(int k=0; k<n*n; k++) cells[k] = k;
+		random.shuffle(cells);
+		for(int k=0; k<n*n; k++)
 		{
-			return 1;
+			full.board[cells[k]].setCoverage(cells[k]/n, cells[k]%n, (k%2==0) ? BLUE : RED);
 		}
+		measure("game_over", n, [&]{sink += gameOver(full, full.pc);}, baseline, save);
+		measure("simulate", n, [&]{sink += simulate(n/2, n/2, &empty, random);}, baseline, save);
 	}
-	return 0;
-};
+	if(save.is_open() && !save) cout<<"can't write "<<saveFile<<endl;
+	if(sink<0) cout<<sink<<endl; //never true, but the compiler can't know
+}
 
-bool gameOver(hexg g, player& pl) //this function checks if there is a winner
+int main(int argc, char* argv[])
 {
-	if(pl.colour==RED)
+	if(argc>1 && string(argv[1])=="--bench") //benchmarks instead of a game: --bench [--save FILE] [--compare FILE]
 	{
-		int counter=0;
-		int counter2=0;
-		vp temp;
-		vp::iterator base;
-		for(vp::iterator a=pl.path.begin(); a!=pl.path.end(); a++)
+		string saveFile, compareFile;
+		for(int i=2; i+1<argc; i+=2)
 		{
-			if(((*a)->y==g.dimension-1))
-			{
-				for(vp::iterator p=pl.path.begin(); p!=pl.path.end(); p++)
-				{
-					if(((*p)->y==0))
-					{
-						temp.push_back(*p);
-						base=p;
-						while(counter<pl.path.size() && counter2<pl.path.size())
-						{
-							counter2++;
-							for(vp::iterator q=pl.path.begin(); q!=pl.path.end(); q++)
-							{	
-								counter++;
-								if((move(g.dimension,*(*base),*(*q))) && !check(temp, *q))
-								{
-									base=q;
-									temp.push_back(*base);
-									counter=0;
-								}
-								if(((*base)->y)==(g.dimension-1))
-								{
-									return 1;
-								}
-							}
-						}
-					}
-				}
-			}
-		return 0;
+			if(string(argv[i])=="--save") saveFile = argv[i+1];
+			else if(string(argv[i])=="--compare") compareFile = argv[i+1];
 		}
+		benchmark(saveFile, compareFile);
+		return 0;
 	}
-	else if(pl.colour==BLUE) //the same as above for the second player
+	int budget = 2000; //the thinking time of the AI for each move in milliseconds
+	bool seeded = false; //the seed is taken from the clock unless one is given
+	uint64_t seed = 0;
+	for(int i=1; i<argc; i++) //the options: [--seed S] [--time MS]
 	{
-		int counter=0;
-		int counter2=0;
-		vp temp;
-		vp::iterator base;
-		for(vp::iterator a=pl.path.begin(); a!=pl.path.end(); a++)
+		string option = argv[i];
+		if(option=="--time" && i+1<argc)
 		{
-			if(((*a)->x==g.dimension-1))
-			{
-				for(vp::iterator p=pl.path.begin(); p!=pl.path.end(); p++)
-				{
-					if(((*p)->x==0))
-					{
-						temp.push_back(*p);
-						base=p;
-						while(counter<pl.path.size() && counter2<pl.path.size())
-						{
-							counter2++;
-							for(vp::iterator q=pl.path.begin(); q!=pl.path.end(); q++)
-							{	
-								counter++;
-								if((move(g.dimension,*(*base),*(*q))) && !check(temp, *q))
-								{
-									base=q;
-									temp.push_back(*base);
-									counter=0;
-								}
-								if(((*base)->x)==(g.dimension-1))
-								{
-									return 1;
-								}
-							}
-						}
-					}
-				}
-			}
+			budget = atoi(argv[++i]);
+		}
+		else if(option=="--seed" && i+1<argc) //a seed repeats a game
+		{
+			seed = strtoull(argv[++i], NULL, 10);
+			seeded = true;
+		}
+		else
+		{
+			cout<<"unknown option "<<option<<endl;
+			cout<<"usage: hex [--seed S] [--time MS] | --bench [--save FILE] [--compare FILE]"<<endl;
+			return 1;
 		}
-		return 0;
 	}
-};
-
-int main()
-{
-	srand(time(NULL));
 	int round=0; //just a counter for the duration of the game
 	hexg game; //create a game
+	game.pc.setBudget(budget);
+	if(seeded) game.pc.setSeed(seed);
 	game.printBoard(); //initialize the first round
 	game.setCoverage(); //initialize the first round
 	round++; //initialize the first round